@@ -0,0 +1,48 @@
+/*
+  DABDUINO FM scan example
+  Scan whole FM band in one pass and print station list
+  www.dabduino.com
+*/
+
+#include "DABDUINO.h"
+
+#define _DAB_SERIAL_PORT Serial1
+#define _DAB_RESET_PIN 7
+#define _DAB_DAC_MUTE_PIN 9
+#define _DAB_SPI_CS_PIN 10
+
+#define FM_MAX_STATIONS 32
+
+DABDUINO dab = DABDUINO(_DAB_SERIAL_PORT, _DAB_RESET_PIN, _DAB_DAC_MUTE_PIN, _DAB_SPI_CS_PIN);
+
+DABFMStation stations[FM_MAX_STATIONS];
+
+void setup() {
+
+  Serial.begin(57600);
+
+  Serial.println("DAB RESET & START");
+  dab.init();
+
+  Serial.println("Scan FM band...");
+  unsigned long startMillis = millis();
+  uint8_t found = dab.scanFM(stations, FM_MAX_STATIONS, true);
+  Serial.print("Found ");
+  Serial.print(found);
+  Serial.print(" stations in ");
+  Serial.print(millis() - startMillis);
+  Serial.println(" ms");
+
+  for (uint8_t i = 0; i < found; i++) {
+    Serial.print(stations[i].frequency);
+    Serial.print(" kHz\t RSSI ");
+    Serial.print(stations[i].signalStrength);
+    Serial.print("\t PI ");
+    Serial.print(stations[i].piCode, HEX);
+    Serial.print("\t ");
+    Serial.println(stations[i].psName);
+  }
+}
+
+void loop() {
+}
@@ -6,6 +6,7 @@
 */
 
 #include "DABDUINO.h"
+#include "DABStations.h"
 
 #define _DAB_SERIAL_PORT Serial1
 #define _DAB_RESET_PIN 7
@@ -13,6 +14,7 @@
 #define _DAB_SPI_CS_PIN 10
 
 DABDUINO dab = DABDUINO(_DAB_SERIAL_PORT, _DAB_RESET_PIN, _DAB_DAC_MUTE_PIN, _DAB_SPI_CS_PIN);
+DABStations stations = DABStations(dab); // program names read once after search
 
 // DAB variables
 char dabText[DAB_MAX_TEXT_LENGTH];
@@ -78,12 +80,14 @@ void setup() {
   Serial.println("");
 
   dab.getProgramIndex(&programsIndex);
+  stations.load(DAB_STATION_NAME);
   Serial.println("Available programs: ");
   for (uint32_t i = 0; i <= programsIndex; i++) {
-    if (dab.getProgramLongName(i, dabText)) {
+    DABStation *station = stations.getStation(i);
+    if (station) {
       Serial.print(i);
       Serial.print("\t ");
-      Serial.println(dabText);
+      Serial.println(station->name);
     }
   }
   Serial.println();
@@ -113,12 +117,16 @@ void loop() {
       programIndex = 0;
     }
 
-    if (dab.playDAB(programIndex)) {
-      if (dab.getProgramLongName(programIndex, dabText)) {
+    if (dab.tune(0, programIndex)) { // 0=DAB, DAC is muted until program plays
+      DABStation *station = stations.getStation(programIndex);
+      if (station) {
         Serial.print("Tuned program: (");
         Serial.print(programIndex);
         Serial.print(") ");
-        Serial.println(dabText);
+        Serial.print(station->name);
+        Serial.print(" in ");
+        Serial.print(dab.getTuneTime());
+        Serial.println(" ms");
       }
     }
   }
@@ -133,7 +141,7 @@ void loop() {
         break;
       case 2:
         //do something when New DAB progam text
-        if (dab.getProgramText(dabText)) { // new text
+        if (dab.getProgramText(dabText) == 1) { // new text
           Serial.print("DAB text event: ");
           Serial.println(dabText);
         }
@@ -0,0 +1,62 @@
+/*
+  DABDUINO multi module example
+  Two DABDUINO shields on separate serial ports served from one loop,
+  signal quality of both is polled without blocking
+  www.dabduino.com
+*/
+
+#include "DABDUINO.h"
+#include "DABModules.h"
+
+DABDUINO dab1 = DABDUINO(Serial1, 7, 9, 10);
+DABDUINO dab2 = DABDUINO(Serial2, 6, 8, 5);
+
+DABModules modules;
+
+unsigned long lastMillis = 0;
+
+void signalQuality(void * /* context */, uint8_t index, int8_t status, byte dabData[], uint32_t dabDataSize) {
+
+  if (status && dabDataSize) {
+    Serial.print("Module ");
+    Serial.print(index);
+    Serial.print(" signal quality ");
+    Serial.println(dabData[0]);
+  }
+}
+
+void setup() {
+
+  Serial.begin(57600);
+
+  Serial.println("DAB RESET & START");
+  dab1.init();
+  dab2.init();
+  modules.add(dab1);
+  modules.add(dab2);
+
+  dab1.playDAB(0);
+  dab2.playDAB(1);
+}
+
+void loop() {
+
+  modules.poll();
+
+  DABEvent event;
+  uint8_t module;
+  while (modules.readEvent(&event, &module)) {
+    Serial.print("Module ");
+    Serial.print(module);
+    Serial.print(" event ");
+    Serial.println(event.type);
+  }
+
+  if (millis() - lastMillis > 1000) {
+    lastMillis = millis();
+    byte dabCommand[7] = { 0xFE, 0x01, 0x13, 0x00, 0x00, 0x00, 0xFD };
+    for (uint8_t i = 0; i < modules.getCount(); i++) {
+      modules.getModule(i)->queueCommand(dabCommand, signalQuality, NULL, i, DAB_PRIORITY_BACKGROUND);
+    }
+  }
+}
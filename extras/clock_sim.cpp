@@ -0,0 +1,92 @@
+/*
+ * clock_sim.cpp - DABClock against simulated module RTC running 100 ppm fast.
+ * RTC gets set from DAB stream after 1 s, is stepped by 1 h after 2000 s,
+ * does not answer RTC reads from 2200 s to 2500 s (resync retries are
+ * counted). Prints drift estimate, time error and steps.
+ *
+ * Build: g++ -Ihost -I../src -o clock_sim clock_sim.cpp host/host_module.cpp ../src/DAB*.cpp
+ * Usage: clock_sim [ppm]
+ * @license  BSD (see license.txt)
+ */
+
+#include "host_module.h"
+#include "DABClock.h"
+
+#define SIM_SET_TIME 1000UL // RTC set from DAB stream (ms)
+#define SIM_STEP_TIME 2000000UL // RTC stepped by 1 h (ms)
+#define SIM_OUTAGE_START 2200000UL // RTC reads not answered (ms)
+#define SIM_OUTAGE_END 2500000UL
+#define SIM_END 4000000UL
+
+struct SimRtc
+{
+  double rate; // RTC seconds per millis() second
+  uint32_t base; // RTC time at millis() 0
+  uint32_t reads;
+  uint32_t outageReads;
+};
+
+static uint32_t rtcNow(SimRtc *rtc) {
+
+  return rtc->base + (uint32_t)(hostMillis * rtc->rate / 1000);
+}
+
+static boolean rtcHook(void *context, HostModule *module, const std::vector<byte> &frame) {
+
+  SimRtc *rtc = (SimRtc *)context;
+  if (frame[1] != 0x02) {
+    return false;
+  }
+  if (frame[2] == 0x01) {
+    rtc->reads++;
+    if (hostMillis >= SIM_OUTAGE_START && hostMillis < SIM_OUTAGE_END) {
+      rtc->outageReads++;
+      return true; // no answer
+    }
+    DABRtcTime time;
+    DABClock::fromEpoch(rtcNow(rtc), &time);
+    module->answer(0x02, 0x01, { time.second, time.minute, time.hour, time.day, time.week, time.month, time.year });
+    return true;
+  }
+  if (frame[2] == 0x04) {
+    module->answer(0x02, 0x04, { (byte)(hostMillis >= SIM_SET_TIME) });
+    return true;
+  }
+  return false;
+}
+
+static int32_t timeError(DABClock *clock, SimRtc *rtc) {
+
+  return (int32_t)(clock->now() - rtcNow(rtc));
+}
+
+int main(int argc, char *argv[]) {
+
+  SimRtc rtc;
+  rtc.rate = 1.0 + ((argc > 1) ? atof(argv[1]) : 100.0) / 1e6;
+  DABRtcTime start = { 24, 10, 0, 19, 12, 15, 30, DAB_STATUS_OK };
+  rtc.base = DABClock::toEpoch(&start);
+  rtc.reads = 0;
+  rtc.outageReads = 0;
+  HostModule module;
+  module.latency = 5;
+  module.setHook(rtcHook, &rtc);
+  hostTick = true;
+  DABDUINO dab(Serial1, 1, 2, 3);
+  DABClock clock(dab);
+  clock.setResyncPeriod(120000);
+
+  while (hostMillis < SIM_STEP_TIME) {
+    clock.poll();
+  }
+  printf("after %lu s: drift %ld ppm, time error %ld s, syncs %lu, RTC reads %lu\n", hostMillis / 1000,
+         (long)clock.getDrift(), (long)timeError(&clock, &rtc), (unsigned long)clock.getSyncs(), (unsigned long)rtc.reads);
+  rtc.base += 3600;
+  while (hostMillis < SIM_END) {
+    clock.poll();
+  }
+  printf("after %lu s: drift %ld ppm, time error %ld s, steps %lu\n", hostMillis / 1000,
+         (long)clock.getDrift(), (long)timeError(&clock, &rtc), (unsigned long)clock.getSteps());
+  printf("RTC reads during %lu s outage: %lu\n", (SIM_OUTAGE_END - SIM_OUTAGE_START) / 1000, (unsigned long)rtc.outageReads);
+  return 0;
+}
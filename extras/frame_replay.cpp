@@ -0,0 +1,152 @@
+/*
+ * frame_replay.cpp - replay DABDUINO serial link log (see DABLog.h) on host.
+ * Received bytes are logged as read from serial line, here they are split into
+ * frames by DABParser (frame time = time of record with its last byte).
+ * Prints answer latency, events, NACKs and parser throughput.
+ *
+ * Build: g++ -O2 -I../src -o frame_replay frame_replay.cpp ../src/DABLog.cpp ../src/DABParser.cpp
+ * Usage: frame_replay [-v] link.log
+ * @license  BSD (see license.txt)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "DABLog.h"
+
+#define REPLAY_REPEATS 100 // passes for parser throughput
+#define REPLAY_IN_FLIGHT 16 // pipelined commands waiting for answer
+
+static void printFrame(uint32_t micros, uint8_t direction, const byte frame[], uint16_t frameSize) {
+
+  printf("%10u %s", (unsigned)micros, direction == DAB_FRAME_TX ? "TX" : "RX");
+  for (uint16_t i = 0; i < frameSize; i++) {
+    printf(" %02X", frame[i]);
+  }
+  printf("\n");
+}
+
+/*
+ * Feed all received bytes through parser
+ * return: number of received frames
+ */
+static unsigned replay(const byte *log, uint32_t logSize, DABParser *parser, unsigned long *bytes) {
+
+  DABLogRecord record;
+  unsigned frames = 0;
+  uint32_t length;
+  parser->reset();
+  for (uint32_t offset = 0; (length = DABLog::parseRecord(log + offset, logSize - offset, &record)); offset += length) {
+    if (record.direction != DAB_FRAME_RX) {
+      continue;
+    }
+    for (uint16_t i = 0; i < record.frameSize; i++) {
+      if (parser->feed(record.frame[i])) {
+        frames++;
+      }
+    }
+    *bytes += record.frameSize;
+  }
+  return frames;
+}
+
+int main(int argc, char *argv[]) {
+
+  boolean verbose = (argc > 2 && strcmp(argv[1], "-v") == 0);
+  if (argc < 2 || (argc > 2 && !verbose)) {
+    fprintf(stderr, "usage: %s [-v] link.log\n", argv[0]);
+    return 1;
+  }
+  FILE *file = fopen(argv[argc - 1], "rb");
+  if (!file) {
+    perror(argv[argc - 1]);
+    return 1;
+  }
+  fseek(file, 0, SEEK_END);
+  long logSize = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  byte *log = (byte *)malloc(logSize ? logSize : 1);
+  if (fread(log, 1, logSize, file) != (size_t)logSize) {
+    perror(argv[argc - 1]);
+    return 1;
+  }
+  fclose(file);
+
+  DABLogRecord record;
+  DABParser parser;
+  uint32_t length;
+  uint32_t offset = 0;
+  unsigned tx = 0, rx = 0, nacks = 0, answers = 0;
+  unsigned long rxBytes = 0;
+  unsigned events[16] = { 0 };
+  uint32_t sentMicros[REPLAY_IN_FLIGHT]; // answers come in order of commands
+  uint8_t sentHead = 0, waiting = 0;
+  uint32_t latency, minLatency = 0xFFFFFFFF, maxLatency = 0;
+  double totalLatency = 0;
+  for (; (length = DABLog::parseRecord(log + offset, logSize - offset, &record)); offset += length) {
+    if (record.direction == DAB_FRAME_TX) {
+      if (verbose) {
+        printFrame(record.micros, record.direction, record.frame, record.frameSize);
+      }
+      tx++;
+      if (waiting < REPLAY_IN_FLIGHT) {
+        sentMicros[(sentHead + waiting++) % REPLAY_IN_FLIGHT] = record.micros;
+      }
+      continue;
+    }
+    rxBytes += record.frameSize;
+    for (uint16_t i = 0; i < record.frameSize; i++) {
+      if (!parser.feed(record.frame[i])) {
+        continue;
+      }
+      if (verbose) {
+        printFrame(record.micros, record.direction, parser.getFrame(), parser.getFrameSize());
+      }
+      rx++;
+      if (parser.isEvent()) {
+        events[(parser.getId() + 1) & 0x0F]++;
+        continue;
+      }
+      if (parser.isNack()) {
+        nacks++;
+      }
+      if (waiting) {
+        latency = record.micros - sentMicros[sentHead];
+        sentHead = (sentHead + 1) % REPLAY_IN_FLIGHT;
+        waiting--;
+        totalLatency += latency;
+        if (latency < minLatency) minLatency = latency;
+        if (latency > maxLatency) maxLatency = latency;
+        answers++;
+      }
+    }
+  }
+  if (offset != (uint32_t)logSize) {
+    printf("truncated record at offset %u\n", (unsigned)offset);
+  }
+
+  printf("frames: %u TX, %u RX (%lu bytes), %u NACK\n", tx, rx, rxBytes, nacks);
+  if (answers) {
+    printf("answer latency: min %u us, avg %.0f us, max %u us\n", (unsigned)minLatency, totalLatency / answers, (unsigned)maxLatency);
+  }
+  for (uint8_t type = 0; type < 16; type++) {
+    if (events[type]) {
+      printf("event %u: %u\n", type, events[type]);
+    }
+  }
+
+  if (rxBytes) {
+    unsigned long bytes = 0;
+    clock_t start = clock();
+    for (int i = 0; i < REPLAY_REPEATS; i++) {
+      replay(log, logSize, &parser, &bytes);
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if (seconds > 0) {
+      printf("parser throughput: %.1f MB/s\n", bytes / seconds / 1e6);
+    }
+  }
+  free(log);
+  return 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * Arduino.h - minimal Arduino API for running DABDUINO library on PC (extras
+ * simulations only). Time is simulated, serial line is connected to HostModule
+ * (see host_module.h).
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef HostArduino_h
+#define HostArduino_h
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define B00000000 0
+#define B00000001 1
+#define B00000010 2
+#define B00000011 3
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+class Print
+{
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  size_t write(const uint8_t *buffer, size_t size) {
+    for (size_t i = 0; i < size; i++) write(buffer[i]);
+    return size;
+  }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() = 0;
+  void setTimeout(unsigned long timeout) { (void)timeout; }
+};
+
+class HardwareSerial : public Stream
+{
+public:
+  void begin(unsigned long baud);
+  int available();
+  int read();
+  int peek();
+  void flush();
+  size_t write(uint8_t c);
+  using Print::write;
+};
+
+extern HardwareSerial Serial1;
+
+#endif
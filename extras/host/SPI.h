@@ -0,0 +1,31 @@
+/*
+ * SPI.h - SPI stub for running DABDUINO library on PC, reads give no data.
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef HostSPI_h
+#define HostSPI_h
+
+#include "Arduino.h"
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+class SPISettings
+{
+public:
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) { (void)clock; (void)bitOrder; (void)dataMode; }
+};
+
+class SPIClass
+{
+public:
+  void begin() {}
+  void beginTransaction(SPISettings settings) { (void)settings; }
+  void endTransaction() {}
+  uint8_t transfer(uint8_t data) { (void)data; return 0xFF; }
+};
+
+extern SPIClass SPI;
+
+#endif
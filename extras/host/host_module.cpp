@@ -0,0 +1,208 @@
+/*
+ * host_module.cpp - simulated DAB module and Arduino API for extras simulations.
+ * @license  BSD (see license.txt)
+ */
+
+#include "host_module.h"
+#include <SPI.h>
+#include <deque>
+
+unsigned long hostMillis = 0;
+boolean hostTick = false;
+HostModule *hostModule = NULL;
+HardwareSerial Serial1;
+SPIClass SPI;
+
+struct HostByte
+{
+  unsigned long due;
+  byte data;
+};
+
+static std::deque<HostByte> rxBytes;
+static std::vector<byte> txFrame;
+
+unsigned long millis() {
+
+  if (hostTick) hostMillis++;
+  return hostMillis;
+}
+
+unsigned long micros() {
+
+  return hostMillis * 1000;
+}
+
+void delay(unsigned long ms) {
+
+  hostMillis += ms;
+}
+
+void delayMicroseconds(unsigned int us) {
+
+  (void)us;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+
+  (void)pin;
+  (void)value;
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+
+  (void)baud;
+}
+
+int HardwareSerial::available() {
+
+  int count = 0;
+  while (count < (int)rxBytes.size() && rxBytes[count].due <= hostMillis) count++;
+  if (!count && (!rxBytes.empty() || (hostModule && hostModule->silent))) {
+    hostMillis++; // caller waits for module
+  }
+  return count;
+}
+
+int HardwareSerial::read() {
+
+  if (rxBytes.empty() || rxBytes.front().due > hostMillis) return -1;
+  byte data = rxBytes.front().data;
+  rxBytes.pop_front();
+  return data;
+}
+
+int HardwareSerial::peek() {
+
+  if (rxBytes.empty() || rxBytes.front().due > hostMillis) return -1;
+  return rxBytes.front().data;
+}
+
+void HardwareSerial::flush() {
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+
+  txFrame.push_back(c);
+  if (c == 0xFD && txFrame.size() >= 7 && txFrame.size() >= 7u + ((txFrame[4] << 8) | txFrame[5])) {
+    if (hostModule) hostModule->command(txFrame);
+    txFrame.clear();
+  }
+  return 1;
+}
+
+HostModule::HostModule() {
+
+  latency = 0;
+  commands = 0;
+  silent = false;
+  playStatus = 0;
+  playMode = 0;
+  playIndex = 0;
+  hook = NULL;
+  hookContext = NULL;
+  hostModule = this;
+}
+
+void HostModule::setHook(HostHook hook, void *context) {
+
+  this->hook = hook;
+  hookContext = context;
+}
+
+/*
+ * Send frame to library after latency, frames stay in order
+ */
+void HostModule::answer(byte commandClass, byte commandId, const std::vector<byte> &data) {
+
+  silent = false;
+  unsigned long due = hostMillis + latency;
+  if (!rxBytes.empty() && rxBytes.back().due > due) due = rxBytes.back().due;
+  std::vector<byte> frame = { 0xFE, commandClass, commandId, 0x00, (byte)(data.size() >> 8), (byte)data.size() };
+  frame.insert(frame.end(), data.begin(), data.end());
+  frame.push_back(0xFD);
+  for (size_t i = 0; i < frame.size(); i++) {
+    HostByte b = { due, frame[i] };
+    rxBytes.push_back(b);
+  }
+}
+
+/*
+ * Send event (1..7, see DABDUINO::readEvent)
+ */
+void HostModule::event(int8_t type, const std::vector<byte> &data) {
+
+  answer(0x07, type - 1, data);
+}
+
+static std::vector<byte> u16(uint32_t value) {
+
+  return { (byte)(value >> 8), (byte)value };
+}
+
+static std::vector<byte> u32(uint32_t value) {
+
+  return { (byte)(value >> 24), (byte)(value >> 16), (byte)(value >> 8), (byte)value };
+}
+
+void HostModule::command(const std::vector<byte> &frame) {
+
+  commands++;
+  silent = true; // until answer
+  if (hook && hook(hookContext, this, frame)) return;
+  byte commandClass = frame[1];
+  byte commandId = frame[2];
+  uint32_t index = (frame.size() >= 10) ? ((uint32_t)frame[6] << 24) + ((uint32_t)frame[7] << 16) + (frame[8] << 8) + frame[9] : 0;
+  const HostStation *station = (index < stations.size()) ? &stations[index] : NULL;
+  if (commandClass == 0x01) {
+    switch (commandId) {
+    case 0x00:
+      playMode = frame[6];
+      playIndex = index;
+      playStatus = 0;
+      return answer(0x00, 0x01, {});
+    case 0x05: return answer(commandClass, commandId, { playStatus });
+    case 0x06: return answer(commandClass, commandId, { playMode });
+    case 0x07: return answer(commandClass, commandId, u32(playIndex));
+    case 0x08: return answer(commandClass, commandId, { 12, 0, 5 });
+    case 0x0D: return answer(commandClass, commandId, { 8 }); // volume
+    case 0x12: return answer(commandClass, commandId, u16(128)); // data rate
+    case 0x13: return answer(commandClass, commandId, { 90 }); // signal quality
+    case 0x16: return answer(commandClass, commandId, u32(stations.size()));
+    case 0x0F:
+    case 0x1A:
+      if (station) {
+        std::vector<byte> name;
+        for (const char *c = station->name; *c; c++) {
+          name.push_back(0x00);
+          name.push_back(*c);
+        }
+        return answer(commandClass, commandId, name);
+      }
+      break;
+    case 0x23:
+      if (station) {
+        std::vector<byte> info = u32(station->serviceId);
+        info.push_back(station->ensembleId >> 8);
+        info.push_back(station->ensembleId);
+        return answer(commandClass, commandId, info);
+      }
+      break;
+    case 0x14: if (station) return answer(commandClass, commandId, { station->frequencyIndex }); break;
+    case 0x1E: if (station) return answer(commandClass, commandId, { station->serviceType }); break;
+    case 0x17: if (station) return answer(commandClass, commandId, { 1 }); break;
+    default: return answer(commandClass, commandId, { 0 });
+    }
+    return answer(0x00, 0x02, {}); // NACK
+  }
+  if (commandClass == 0x07) {
+    return answer(0x00, 0x01, {}); // ACK
+  }
+  answer(commandClass, commandId, { 0 });
+}
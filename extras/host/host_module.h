@@ -0,0 +1,65 @@
+/*
+ * host_module.h - simulated DAB module on Serial1 for extras simulations.
+ * Answers commands after set latency from a small program database, hook
+ * takes over single commands (RTC, play status, lost answers...).
+ *
+ * Time: millis() is simulated. It moves with delay(), with serial polling
+ * while an answer is on its way or the last command got none (1 ms per poll)
+ * and, with hostTick, with every millis() call. Loops waiting for anything
+ * else (events, rate limits) have to move time themselves.
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef HostModule_h
+#define HostModule_h
+
+#include "DABDUINO.h"
+#include <vector>
+
+extern unsigned long hostMillis;
+extern boolean hostTick;
+
+struct HostStation
+{
+  const char *name;
+  uint32_t serviceId;
+  uint16_t ensembleId;
+  uint8_t frequencyIndex;
+  uint8_t serviceType;
+};
+
+class HostModule;
+
+/*
+ * Hook for commands, frame = whole command frame
+ * return: true=command answered by hook
+ */
+typedef boolean (*HostHook)(void *context, HostModule *module, const std::vector<byte> &frame);
+
+class HostModule
+{
+public:
+
+  HostModule();
+
+  void setHook(HostHook hook, void *context);
+  void answer(byte commandClass, byte commandId, const std::vector<byte> &data);
+  void event(int8_t type, const std::vector<byte> &data);
+  void command(const std::vector<byte> &frame);
+
+  unsigned long latency; // answer delay (ms)
+  std::vector<HostStation> stations;
+  uint32_t commands;
+  boolean silent; // last command not answered (e.g. by hook)
+  uint8_t playStatus; // 0=playing
+  uint8_t playMode; // 0=DAB, 1=FM
+  uint32_t playIndex;
+
+private:
+  HostHook hook;
+  void *hookContext;
+};
+
+extern HostModule *hostModule;
+
+#endif
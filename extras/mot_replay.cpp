@@ -0,0 +1,70 @@
+/*
+ * mot_replay.cpp - replay captured DABDUINO SPI stream through MOT decoder on host.
+ * Stream is sequence of MSC data groups, each prefixed by 2 byte size (as read by DABDUINO::readMOTdata).
+ * Every complete object (header or directory mode) is written to current directory under its ContentName.
+ *
+ * Build: g++ -I../src -o mot_replay mot_replay.cpp ../src/DABMOT.cpp
+ * Usage: mot_replay capture.bin
+ * @license  BSD (see license.txt)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "DABMOT.h"
+
+static FILE *slide = NULL;
+static unsigned slides = 0;
+
+static void slideSink(void * /* context */, const DABMOTObject *object, const byte data[], uint16_t dataSize) {
+
+  if (object->received == 0 && dataSize) {
+    char name[DAB_MOT_MAX_NAME_LENGTH + 16];
+    if (object->contentName[0]) {
+      snprintf(name, sizeof(name), "%s", object->contentName);
+    } else {
+      snprintf(name, sizeof(name), "slide_%04x.%s", object->transportId, object->contentSubType == DAB_MOT_SUBTYPE_PNG ? "png" : "jpg");
+    }
+    if (slide) fclose(slide);
+    slide = fopen(name, "wb");
+  }
+  if (!slide) return;
+  if (dataSize) {
+    fwrite(data, 1, dataSize, slide);
+  } else {
+    fclose(slide);
+    slide = NULL;
+    slides++;
+    printf("slide %04x %s (%u bytes)\n", object->transportId, object->contentName, (unsigned)object->bodySize);
+  }
+}
+
+int main(int argc, char *argv[]) {
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s capture.bin\n", argv[0]);
+    return 1;
+  }
+  FILE *f = fopen(argv[1], "rb");
+  if (!f) {
+    perror(argv[1]);
+    return 1;
+  }
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  byte *stream = (byte *)malloc(size);
+  if (!stream || fread(stream, 1, size, f) != (size_t)size) {
+    fprintf(stderr, "read error\n");
+    return 1;
+  }
+  fclose(f);
+
+  DABMOT mot;
+  mot.setSink(slideSink, NULL);
+  uint32_t groups = mot.feedStream(stream, size);
+  printf("%u data groups, %u slides\n", (unsigned)groups, slides);
+  const DABMOTStats *stats = mot.getStats();
+  printf("%u CRC errors, %u segments dropped, %u objects rejected, %u repeats needed, %u directories\n", (unsigned)stats->crcErrors, (unsigned)stats->segmentsDropped, (unsigned)stats->objectsRejected, (unsigned)stats->repeats, (unsigned)stats->directories);
+  free(stream);
+  return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * power_sim.cpp - DABPower idle mode on simulated module for one hour.
+ * Sleep function models ARM __WFI woken by 1 ms timer tick, module sends
+ * program text event every 3 s and answers after 8 ms; every burst reads
+ * signal quality and volume. Prints awake time per hour and serial line
+ * duty cycle.
+ *
+ * Build: g++ -Ihost -I../src -o power_sim power_sim.cpp host/host_module.cpp ../src/DAB*.cpp
+ * Usage: power_sim [burst period ms]
+ * @license  BSD (see license.txt)
+ */
+
+#include "host_module.h"
+#include "DABPower.h"
+
+#define SIM_TICK 1 // sleep ends by timer tick (ms)
+#define SIM_EVENT_PERIOD 3000 // program text event (ms)
+#define SIM_TIME 3600000UL
+
+static unsigned long nextEvent = SIM_EVENT_PERIOD / 2; // between bursts
+
+static void simSleep(void *context) {
+
+  HostModule *module = (HostModule *)context;
+  hostMillis += SIM_TICK;
+  if (hostMillis >= nextEvent) {
+    nextEvent += SIM_EVENT_PERIOD;
+    module->event(2, {});
+  }
+}
+
+int main(int argc, char *argv[]) {
+
+  HostModule module;
+  module.latency = 8;
+  DABDUINO dab(Serial1, 1, 2, 3);
+  DABPower power(dab);
+  power.setSleep(simSleep, &module);
+  if (argc > 1) {
+    power.setBurstPeriod(atol(argv[1]));
+  }
+  if (!power.begin()) {
+    printf("begin failed\n");
+    return 1;
+  }
+  power.resetStats();
+  uint32_t events = 0;
+  while (hostMillis < SIM_TIME) {
+    if (power.poll()) {
+      dab.getSignalQuality();
+      dab.getVolume();
+    }
+    DABEvent event;
+    while (dab.getEvent(&event)) {
+      events++;
+    }
+    power.idle();
+  }
+
+  DABPowerStats stats;
+  power.getStats(&stats);
+  printf("total %lu ms, awake %lu ms, link %lu ms, wakeups %lu, bursts %lu, events %lu\n",
+         (unsigned long)stats.totalTime, (unsigned long)stats.awakeTime, (unsigned long)stats.linkTime,
+         (unsigned long)stats.wakeups, (unsigned long)stats.bursts, (unsigned long)events);
+  printf("awake per hour %lu ms, link duty cycle %u per mille\n", (unsigned long)power.getAwakePerHour(),
+         power.getLinkDutyCycle());
+  return 0;
+}
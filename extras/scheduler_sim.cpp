@@ -0,0 +1,49 @@
+/*
+ * scheduler_sim.cpp - latency of non-blocking command priorities on simulated module.
+ * Background getter is queued whenever there is room, playback status every
+ * 100 ms, interactive getter every 250 ms; module answers after 8 ms.
+ * Prints per priority command count, average/max latency, dropped and promoted.
+ *
+ * Build: g++ -Ihost -I../src -o scheduler_sim scheduler_sim.cpp host/host_module.cpp ../src/DAB*.cpp
+ * Usage: scheduler_sim [seconds]
+ * @license  BSD (see license.txt)
+ */
+
+#include "host_module.h"
+
+int main(int argc, char *argv[]) {
+
+  unsigned long duration = (argc > 1) ? atol(argv[1]) * 1000UL : 60000UL;
+  HostModule module;
+  module.latency = 8;
+  DABDUINO dab(Serial1, 1, 2, 3);
+
+  byte signalQuality[7] = { 0xFE, 0x01, 0x13, 0x00, 0x00, 0x00, 0xFD };
+  byte playStatus[7] = { 0xFE, 0x01, 0x05, 0x00, 0x00, 0x00, 0xFD };
+  byte volume[7] = { 0xFE, 0x01, 0x0D, 0x00, 0x00, 0x00, 0xFD };
+  unsigned long nextInteractive = 0;
+  unsigned long nextPlayback = 0;
+  while (hostMillis < duration) {
+    delay(1); // rest of loop()
+    dab.poll();
+    dab.queueCommand(signalQuality, NULL, NULL, 0, DAB_PRIORITY_BACKGROUND);
+    if (hostMillis >= nextPlayback) {
+      dab.queueCommand(playStatus, NULL, NULL, 0, DAB_PRIORITY_PLAYBACK);
+      nextPlayback = hostMillis + 100;
+    }
+    if (hostMillis >= nextInteractive) {
+      dab.queueCommand(volume, NULL, NULL, 0, DAB_PRIORITY_INTERACTIVE);
+      nextInteractive = hostMillis + 250;
+    }
+  }
+
+  const char *names[DAB_PRIORITIES] = { "interactive", "playback", "background" };
+  for (uint8_t priority = 0; priority < DAB_PRIORITIES; priority++) {
+    const DABQueueStats *stats = dab.getQueueStats(priority);
+    printf("%-11s %6lu commands (%.1f/s), latency avg %lu ms max %u ms, dropped %lu, promoted %lu\n", names[priority],
+           (unsigned long)stats->commands, stats->commands * 1000.0 / duration,
+           stats->commands ? (unsigned long)(stats->totalLatency / stats->commands) : 0UL, (unsigned)stats->maxLatency,
+           (unsigned long)stats->dropped, (unsigned long)stats->promoted);
+  }
+  return 0;
+}
@@ -0,0 +1,29 @@
+#!/bin/sh
+#
+# stack_usage.sh - stack frame of DABDUINO getters on PC (-Os -fstack-usage),
+# built with the extras/host Arduino shim. Frames of called functions are
+# not included.
+#
+# Usage: extras/stack_usage.sh [git revision] [getter...]
+# Without revision the working tree is measured.
+# @license  BSD (see license.txt)
+#
+
+root=$(cd "$(dirname "$0")/.." && pwd) || exit 1
+revision=${1:-}
+[ $# -gt 0 ] && shift
+getters=${*:-getVolume getSignalStrength getRTCclock getRDSrawData}
+work=$(mktemp -d) || exit 1
+trap 'rm -rf "$work"' EXIT
+
+if [ -n "$revision" ]; then
+  git -C "$root" archive "$revision" src | tar -x -C "$work" || exit 1
+  src="$work/src"
+else
+  src="$root/src"
+fi
+
+(cd "$work" && ${CXX:-g++} -Os -fstack-usage -w -I"$root/extras/host" -I"$src" -c "$src/DABDUINO.cpp") || exit 1
+for getter in $getters; do
+  grep "DABDUINO::$getter(" "$work/DABDUINO.su" | sed 's/^.*:[0-9]*:[0-9]*://'
+done
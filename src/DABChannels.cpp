@@ -0,0 +1,100 @@
+/*
+ * DABChannels.cpp - DAB channel tables for DABDUINO library.
+ * @license  BSD (see license.txt)
+ */
+
+#include "DABChannels.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define DAB_READ_DWORD(address) pgm_read_dword(address)
+#define DAB_READ_BYTE(address) pgm_read_byte(address)
+#else
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#define DAB_READ_DWORD(address) (*(address))
+#define DAB_READ_BYTE(address) (*(address))
+#endif
+
+/*
+ * Center frequency (kHz) by frequency index - EN 300 401 Band III and L-band.
+ * China band channel plan of module is not documented, its frequencies are 0.
+ */
+static const uint32_t frequencies[DAB_CHANNELS] PROGMEM = {
+  // Band III
+  174928, 176640, 178352, 180064, 181936, 183648, 185360, 187072, // 5A..6D
+  188928, 190640, 192352, 194064, 195936, 197648, 199360, 201072, // 7A..8D
+  202928, 204640, 206352, 208064, // 9A..9D
+  209936, 210096, 211648, 213360, 215072, // 10A, 10N, 10B..10D
+  216928, 217088, 218640, 220352, 222064, // 11A, 11N, 11B..11D
+  223936, 224096, 225648, 227360, 229072, // 12A, 12N, 12B..12D
+  230784, 232496, 234208, 235776, 237488, 239200, // 13A..13F
+  // China band
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  // L-band
+  1452960, 1454672, 1456384, 1458096, 1459808, 1461520, 1463232, 1464944, // LA..LH
+  1466656, 1468368, 1470080, 1471792, 1473504, 1475216, 1476928, 1478640, // LI..LP
+  1480352, 1482064, 1483776, 1485488, 1487200, 1488912, 1490624 // LQ..LW
+};
+
+/*
+ * Band III channel labels by frequency index
+ */
+static const char band3Labels[41][DAB_CHANNEL_LABEL_LENGTH + 1] PROGMEM = {
+  "5A", "5B", "5C", "5D", "6A", "6B", "6C", "6D", "7A", "7B", "7C", "7D",
+  "8A", "8B", "8C", "8D", "9A", "9B", "9C", "9D", "10A", "10N", "10B", "10C", "10D",
+  "11A", "11N", "11B", "11C", "11D", "12A", "12N", "12B", "12C", "12D",
+  "13A", "13B", "13C", "13D", "13E", "13F"
+};
+
+/*
+ * Get center frequency of frequency index
+ * return: kHz, 0=unknown
+ */
+uint32_t DABChannels::getFrequency(uint8_t frequencyIndex) {
+
+  if (frequencyIndex >= DAB_CHANNELS) {
+    return 0;
+  }
+  return DAB_READ_DWORD(&frequencies[frequencyIndex]);
+}
+
+/*
+ * Get channel label of frequency index (e.g. "12C", "LA")
+ * label = buffer for DAB_CHANNEL_LABEL_LENGTH + 1 chars
+ * return: true=label found, false=unknown (China band or invalid index)
+ */
+boolean DABChannels::getLabel(uint8_t frequencyIndex, char label[]) {
+
+  label[0] = '\0';
+  switch (getBand(frequencyIndex)) {
+  case DAB_BAND_3:
+    for (uint8_t i = 0; i <= DAB_CHANNEL_LABEL_LENGTH; i++) {
+      label[i] = DAB_READ_BYTE(&band3Labels[frequencyIndex][i]);
+    }
+    return true;
+  case DAB_L_BAND:
+    label[0] = 'L';
+    label[1] = 'A' + frequencyIndex - first(DAB_L_BAND);
+    label[2] = '\0';
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Find frequency index of channel label (e.g. "12C", "LA")
+ * return: frequency index, 0xFF=not found
+ */
+uint8_t DABChannels::findLabel(const char label[]) {
+
+  char channel[DAB_CHANNEL_LABEL_LENGTH + 1];
+  for (uint8_t i = 0; i < DAB_CHANNELS; i++) {
+    if (getLabel(i, channel) && strcmp(channel, label) == 0) {
+      return i;
+    }
+  }
+  return 0xFF;
+}
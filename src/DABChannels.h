@@ -0,0 +1,55 @@
+/*
+ * DABChannels.h - DAB channel tables for DABDUINO library.
+ * Converts module frequency index (see getFrequency, searchDAB) to channel
+ * label and center frequency. Band limits are constexpr, tables are in
+ * flash on AVR.
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef DABChannels_h
+#define DABChannels_h
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include <stdint.h>
+#include <string.h>
+typedef uint8_t byte;
+typedef bool boolean;
+#endif
+
+// bands (see searchDAB)
+#define DAB_BAND_3 1 // 5A..13F, frequency index 0..40
+#define DAB_CHINA_BAND 2 // frequency index 41..71
+#define DAB_L_BAND 3 // LA..LW, frequency index 72..94
+
+#define DAB_CHANNELS 95
+#define DAB_CHANNEL_LABEL_LENGTH 3
+
+class DABChannels
+{
+public:
+
+  /*
+   * First and last frequency index of band, 0xFF=unknown band
+   */
+  static constexpr uint8_t first(uint8_t band) {
+    return band == DAB_BAND_3 ? 0 : band == DAB_CHINA_BAND ? 41 : band == DAB_L_BAND ? 72 : 0xFF;
+  }
+  static constexpr uint8_t last(uint8_t band) {
+    return band == DAB_BAND_3 ? 40 : band == DAB_CHINA_BAND ? 71 : band == DAB_L_BAND ? 94 : 0xFF;
+  }
+
+  /*
+   * Band of frequency index, 0=invalid index
+   */
+  static constexpr uint8_t getBand(uint8_t frequencyIndex) {
+    return frequencyIndex <= last(DAB_BAND_3) ? DAB_BAND_3 : frequencyIndex <= last(DAB_CHINA_BAND) ? DAB_CHINA_BAND : frequencyIndex <= last(DAB_L_BAND) ? DAB_L_BAND : 0;
+  }
+
+  static uint32_t getFrequency(uint8_t frequencyIndex);
+  static boolean getLabel(uint8_t frequencyIndex, char label[]);
+  static uint8_t findLabel(const char label[]);
+};
+
+#endif
@@ -0,0 +1,232 @@
+/*
+ * DABClock.cpp - Time service for DABDUINO library.
+ * @license  BSD (see license.txt)
+ */
+
+#include "DABClock.h"
+
+DABClock::DABClock(DABDUINO& dab) {
+
+  this->dab = &dab;
+  resyncPeriod = DAB_CLOCK_RESYNC;
+  valid = false;
+  clockSet = false;
+  drift = 0;
+  syncs = 0;
+  steps = 0;
+  syncing = false;
+  nextCheck = millis();
+}
+
+/*
+ * Set period of RTC resync (ms)
+ */
+void DABClock::setResyncPeriod(uint32_t resyncPeriod) {
+
+  this->resyncPeriod = resyncPeriod;
+}
+
+/*
+ * Call often from loop() - resyncs when due or when RTC gets set from DAB
+ * stream; does at most one RTC read per call
+ */
+void DABClock::poll() {
+
+  unsigned long ms = millis();
+  if (!syncing) {
+    if (!clockSet && (long)(ms - nextCheck) >= 0) {
+      // RTC is set from DAB stream some time after tune
+      DABResult status = dab->getRTCclockStatus();
+      nextCheck = ms + DAB_CLOCK_RETRY;
+      if (status.status == DAB_STATUS_OK && status.value == 1) {
+        clockSet = true;
+        startSync();
+      }
+    } else if (clockSet && (long)(ms - nextCheck) >= 0 && (!valid || ms - baseMillis >= resyncPeriod)) {
+      startSync();
+    }
+    if (!syncing) {
+      return;
+    }
+  }
+  if (ms - lastRead < DAB_CLOCK_EDGE_POLL) {
+    return;
+  }
+  lastRead = ms;
+  DABRtcTime time = dab->getRTCclock();
+  if (time.status != DAB_STATUS_OK) {
+    syncing = false;
+    nextCheck = ms + DAB_CLOCK_RETRY;
+    return;
+  }
+  uint32_t epoch = toEpoch(&time);
+  if (!edgeSeen) {
+    edgeSeen = true;
+    edgeEpoch = epoch;
+  } else if (epoch != edgeEpoch) {
+    // second has just changed - RTC is epoch.000 within DAB_CLOCK_EDGE_POLL
+    commit(epoch, ms);
+  } else if (ms - syncStart > DAB_CLOCK_EDGE_TIMEOUT) {
+    commit(epoch, ms);
+  }
+}
+
+/*
+ * Resync now, waits for next RTC second (up to DAB_CLOCK_EDGE_TIMEOUT)
+ * return: 1=ok, 0=error
+ */
+int8_t DABClock::sync() {
+
+  uint32_t lastSyncs = syncs;
+  clockSet = true;
+  startSync();
+  while (syncing) {
+    poll();
+  }
+  return (syncs != lastSyncs) ? 1 : 0;
+}
+
+boolean DABClock::isValid() {
+
+  return valid;
+}
+
+/*
+ * Get time without serial round trip
+ * return: unix time (s), 0=not synced yet
+ */
+uint32_t DABClock::now() {
+
+  if (!valid) {
+    return 0;
+  }
+  return baseEpoch + elapsed(millis()) / 1000;
+}
+
+/*
+ * Get time split to RTC fields (see DABDUINO::getRTCclock)
+ * return: 1=ok, 0=not synced yet
+ */
+int8_t DABClock::getTime(DABRtcTime *time) {
+
+  if (!valid) {
+    time->status = DAB_STATUS_TIMEOUT;
+    return 0;
+  }
+  fromEpoch(now(), time);
+  return 1;
+}
+
+/*
+ * Get drift of module RTC against millis() (ppm), 0=not measured yet
+ */
+int32_t DABClock::getDrift() {
+
+  return drift;
+}
+
+uint32_t DABClock::getSyncs() {
+
+  return syncs;
+}
+
+/*
+ * Get number of clock steps (RTC set from DAB stream or by user)
+ */
+uint32_t DABClock::getSteps() {
+
+  return steps;
+}
+
+/*
+ * Convert RTC fields (year 17=2017) to unix time
+ */
+uint32_t DABClock::toEpoch(const DABRtcTime *time) {
+
+  static const uint16_t monthDays[12] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+  uint8_t month = (time->month >= 1 && time->month <= 12) ? time->month : 1;
+  uint8_t day = time->day ? time->day : 1;
+  uint32_t days = 365UL * time->year + (time->year + 3) / 4 + monthDays[month - 1] + day - 1;
+  if (month > 2 && (time->year % 4) == 0) {
+    days++;
+  }
+  return DAB_EPOCH_2000 + ((days * 24 + time->hour) * 60 + time->minute) * 60UL + time->second;
+}
+
+/*
+ * Convert unix time (2000..2099) to RTC fields, week 0(sat)..6(fri)
+ */
+void DABClock::fromEpoch(uint32_t epoch, DABRtcTime *time) {
+
+  static const uint8_t monthLength[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+  uint32_t seconds = (epoch > DAB_EPOCH_2000) ? epoch - DAB_EPOCH_2000 : 0;
+  uint32_t days = seconds / 86400UL;
+  seconds %= 86400UL;
+  time->status = DAB_STATUS_OK;
+  time->second = seconds % 60;
+  time->minute = (seconds / 60) % 60;
+  time->hour = seconds / 3600;
+  time->week = days % 7; // 2000-01-01 was saturday
+  uint8_t year = 0;
+  while (days >= ((year % 4) ? 365U : 366U)) {
+    days -= (year % 4) ? 365 : 366;
+    year++;
+  }
+  uint8_t month = 0;
+  while (days >= monthLength[month] + ((month == 1 && (year % 4) == 0) ? 1U : 0U)) {
+    days -= monthLength[month] + ((month == 1 && (year % 4) == 0) ? 1 : 0);
+    month++;
+  }
+  time->year = year;
+  time->month = month + 1;
+  time->day = days + 1;
+}
+
+void DABClock::startSync() {
+
+  syncing = true;
+  edgeSeen = false;
+  syncStart = millis();
+  lastRead = syncStart - DAB_CLOCK_EDGE_POLL;
+}
+
+/*
+ * Take RTC second at edgeMillis as new time base, update drift estimate
+ */
+void DABClock::commit(uint32_t epoch, unsigned long edgeMillis) {
+
+  syncing = false;
+  if (valid) {
+    int32_t difference = (int32_t)(epoch - baseEpoch) * 1000 - elapsed(edgeMillis);
+    if (difference > DAB_CLOCK_MAX_STEP || difference < -DAB_CLOCK_MAX_STEP) {
+      steps++;
+      anchorEpoch = epoch;
+      anchorMillis = edgeMillis;
+    } else if (edgeMillis - anchorMillis >= DAB_CLOCK_DRIFT_TIME) {
+      int32_t elapsedMillis = edgeMillis - anchorMillis;
+      int32_t rtcMillis = (int32_t)(epoch - anchorEpoch) * 1000;
+      drift = (int64_t)(rtcMillis - elapsedMillis) * 1000000 / elapsedMillis;
+      if (elapsedMillis > 0x40000000L) {
+        // keep anchor in range of int32_t milliseconds
+        anchorEpoch = epoch;
+        anchorMillis = edgeMillis;
+      }
+    }
+  } else {
+    anchorEpoch = epoch;
+    anchorMillis = edgeMillis;
+  }
+  baseEpoch = epoch;
+  baseMillis = edgeMillis;
+  valid = true;
+  syncs++;
+}
+
+/*
+ * Milliseconds of RTC time since time base, corrected by drift
+ */
+int32_t DABClock::elapsed(unsigned long ms) {
+
+  int32_t elapsedMillis = ms - baseMillis;
+  return elapsedMillis + (int64_t)elapsedMillis * drift / 1000000;
+}
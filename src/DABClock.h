@@ -0,0 +1,68 @@
+/*
+ * DABClock.h - Time service for DABDUINO library.
+ * Reads module RTC once and extrapolates it by millis(), so clock reads
+ * need no serial round trip. Resynchronises periodically and when RTC gets
+ * set from DAB stream, tracks drift of module RTC against millis().
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef DABClock_h
+#define DABClock_h
+
+#include "DABDUINO.h"
+
+#define DAB_CLOCK_RESYNC 600000UL // default resync period (ms)
+#define DAB_CLOCK_RETRY 10000 // resync retry after error, RTC status poll while RTC is unset (ms)
+#define DAB_CLOCK_EDGE_POLL 20 // RTC read period while waiting for second change (ms)
+#define DAB_CLOCK_EDGE_TIMEOUT 1500 // max wait for second change (ms)
+#define DAB_CLOCK_MAX_STEP 2000 // larger difference at resync is clock step, not drift (ms)
+#define DAB_CLOCK_DRIFT_TIME 60000UL // min time between syncs for drift estimate (ms)
+#define DAB_EPOCH_2000 946684800UL // unix time of 2000-01-01 00:00:00
+
+class DABClock
+{
+public:
+
+  DABClock(DABDUINO& dab);
+
+  void setResyncPeriod(uint32_t resyncPeriod);
+  void poll();
+  int8_t sync();
+
+  boolean isValid();
+  uint32_t now();
+  int8_t getTime(DABRtcTime *time);
+  int32_t getDrift();
+  uint32_t getSyncs();
+  uint32_t getSteps();
+
+  static uint32_t toEpoch(const DABRtcTime *time);
+  static void fromEpoch(uint32_t epoch, DABRtcTime *time);
+
+private:
+  void startSync();
+  void commit(uint32_t epoch, unsigned long edgeMillis);
+  int32_t elapsed(unsigned long ms);
+
+  DABDUINO *dab;
+  uint32_t resyncPeriod;
+  boolean valid;
+  boolean clockSet; // RTC status says set
+  uint32_t baseEpoch; // RTC second at baseMillis
+  unsigned long baseMillis;
+  uint32_t anchorEpoch; // first sync since last step, for drift
+  unsigned long anchorMillis;
+  int32_t drift; // ppm, positive = RTC faster than millis()
+  uint32_t syncs;
+  uint32_t steps;
+
+  // resync in progress (waiting for RTC second change)
+  boolean syncing;
+  boolean edgeSeen;
+  uint32_t edgeEpoch;
+  unsigned long syncStart;
+  unsigned long lastRead;
+  unsigned long nextCheck; // next RTC status check or retry
+};
+
+#endif
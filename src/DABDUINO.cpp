@@ -6,6 +6,10 @@
  */
 
 #include "DABDUINO.h"
+#include "DABTextCache.h"
+#include "DABMOT.h"
+#include "DABChannels.h"
+#include <SPI.h>
 
 DABDUINO::DABDUINO(HardwareSerial& serial, int8_t RESET_PIN, int8_t DAC_MUTE_PIN, int8_t SPI_CS_PIN) : _s(serial) {
 
@@ -13,6 +17,37 @@ DABDUINO::DABDUINO(HardwareSerial& serial, int8_t RESET_PIN, int8_t DAC_MUTE_PIN
   resetPin = RESET_PIN;
   dacMutePin = DAC_MUTE_PIN;
   spiCsPin = SPI_CS_PIN;
+  spiStarted = false;
+  eventDataSize = 0;
+  tuneTime = 0;
+  playingMode = 255;
+  playingIndex = 0;
+  memset(queueHead, 0, sizeof(queueHead));
+  memset(queueCount, 0, sizeof(queueCount));
+  resetQueueStats();
+  requestId = 0;
+  memset(waiters, 0, sizeof(waiters));
+  cacheTime = DAB_CACHE_TIME;
+  clearCache();
+  memset(&linkStats, 0, sizeof(linkStats));
+  backgroundTokens = DAB_BACKGROUND_BURST * 1000;
+  tokensMillis = 0;
+  inFlight = false;
+  holdQueue = false;
+  sentMillis = 0;
+  idleSince = 0;
+  tap = NULL;
+  tapChunkLength = 0;
+  tapContext = NULL;
+  eventsHead = 0;
+  eventsCount = 0;
+  eventMask = DAB_EVENT_ALL; // unknown until setEventMask, nothing is filtered
+  eventMaskKnown = false;
+  memset(eventHandlers, 0, sizeof(eventHandlers));
+  memset(eventContexts, 0, sizeof(eventContexts));
+  textHash = 0;
+  textServiceKey = 0;
+  textCache = NULL;
 
 }
 
@@ -120,9 +155,9 @@ void DABDUINO::init() {
   pinMode(dacMutePin, OUTPUT);
   digitalWrite(dacMutePin, HIGH);
 
-  // SPI CS
+  // SPI CS, inactive until readMOTdata transaction
   pinMode(spiCsPin, OUTPUT);
-  digitalWrite(spiCsPin, LOW);
+  digitalWrite(spiCsPin, HIGH);
 
   // DAB module SERIAL
   _Serial->begin(57600);
@@ -138,9 +173,14 @@ void DABDUINO::init() {
   while (!isReady()) {
     delay(100);
   }
+  playingMode = 255; // stopped by reset
+  playingIndex = 0;
 }
 
 int8_t DABDUINO::isEvent() {
+  if (eventsCount) {
+    return eventsCount;
+  }
   return _Serial->available();
 }
 
@@ -149,96 +189,677 @@ int8_t DABDUINO::isEvent() {
  *   RETURN EVENT TYP: 1=scan finish, 2=got new DAB program text, 3=DAB reconfiguration, 4=DAB channel list order change, 5=RDS group, 6=Got new FM radio text, 7=Return the scanning frequency /FM/
  */
 int8_t DABDUINO::readEvent() {
-  byte eventData[16];
-  byte dabReturn[6];
-  byte isPacketCompleted = 0;
-  uint16_t byteIndex = 0;
-  uint16_t dataIndex = 0;
-  byte serialData = 0;
-  uint8_t eventDataSize = 128;
-  unsigned long endMillis = millis() + 200; // timeout for answer from module = 200ms
-  while (millis() < endMillis && dataIndex < DAB_MAX_DATA_LENGTH) {
-    if (_Serial->available() > 0) {
-      serialData = _Serial->read();
-      if (serialData == 0xFE) {
-        byteIndex = 0;
-        dataIndex = 0;
-      }
-      if (eventDataSize && dataIndex < eventDataSize) {
-        eventData[dataIndex++] = serialData;
-      }
-      if (byteIndex <= 5) {
-        dabReturn[byteIndex] = serialData;
-      }
-      if (byteIndex == 5) {
-        eventDataSize = (((long)dabReturn[4] << 8) + (long)dabReturn[5]);
-      }
-      if ((int16_t)(byteIndex - eventDataSize) >= 5 && serialData == 0xFD) {
-        isPacketCompleted = 1;
+  if (!eventsCount && !inFlight && !getQueueLength()) {
+    // wait for event, frame goes through mask and handlers like in poll()
+    unsigned long endMillis = millis() + DAB_COMMAND_TIMEOUT;
+    rx.reset();
+    while (millis() < endMillis) {
+      if (receiveFrame()) {
+        if (rx.isEvent()) {
+          pushEvent(rx.getId() + 1, rx.getData(), rx.getDataSize());
+        }
         break;
       }
-      byteIndex++;
     }
+    drainSerial();
+  } else if (!eventsCount) {
+    // serial line belongs to non-blocking engine
+    poll();
   }
-  while (_Serial->available() > 0) {
-    _Serial->read();
+  eventDataSize = 0;
+  if (!eventsCount) {
+    return 0;
   }
-  if (isPacketCompleted == 1 && dabReturn[1] == 0x07) {
-    return dabReturn[2] + 1;
+  DABEvent *event = &events[eventsHead];
+  eventsHead = (eventsHead + 1) % DAB_EVENT_QUEUE_LENGTH;
+  eventsCount--;
+  eventDataSize = event->dataSize;
+  memcpy(eventData, event->data, event->dataSize);
+  return event->type;
+}
+
+/*
+ *   Get data of last event read by readEvent()
+ *   e.g. event 7: scanning frequency /FM/ (kHz)
+ *   return: 1=event has data, 0=no data
+ */
+int8_t DABDUINO::getEventData(byte data[], uint32_t *dataSize) {
+
+  *dataSize = eventDataSize;
+  if (eventDataSize) {
+    memcpy(data, eventData, eventDataSize);
+    return 1;
   } else {
     return 0;
   }
 }
 
+/*
+ *   Take event received by poll() - never waits for serial line
+ *   return: 1=event, 0=no event
+ */
+int8_t DABDUINO::getEvent(DABEvent *event) {
+
+  if (!eventsCount) {
+    return 0;
+  }
+  *event = events[eventsHead];
+  eventsHead = (eventsHead + 1) % DAB_EVENT_QUEUE_LENGTH;
+  eventsCount--;
+  return 1;
+}
+
 /*
  *  Send command to DAB module and wait for answer
  */
 int8_t DABDUINO::sendCommand(byte dabCommand[], byte dabData[], uint32_t *dabDataSize) {
 
-  byte dabReturn[6];
-  byte isPacketCompleted = 0;
-  uint16_t byteIndex = 0;
-  uint16_t dataIndex = 0;
-  byte serialData = 0;
-  *dabDataSize = 0;
-  while (_Serial->available() > 0) {
-    _Serial->read();
+  return (exchange(dabCommand, dabData, dabDataSize, DAB_MAX_DATA_LENGTH) == DAB_STATUS_OK) ? 1 : 0;
+}
+
+/*
+ *  Send command to DAB module and wait for answer
+ *  dataLength = size of dabData, longer answer is truncated
+ */
+DABStatus DABDUINO::exchange(byte dabCommand[], byte dabData[], uint32_t *dabDataSize, uint16_t dataLength) {
+
+  boolean cacheable = isCacheable(dabCommand);
+  if (cacheable) {
+    if (cacheLookup(dabCommand, dabData, dabDataSize, dataLength)) {
+      return DAB_STATUS_OK;
+    }
+  } else {
+    clearCache(); // command may change module state
+  }
+  waitIdle();
+  drainSerial();
+  rx.reset();
+  unsigned long startMillis = millis();
+  writeCommand(dabCommand);
+  DABStatus status = receive(dabCommand, dabData, dabDataSize, dataLength);
+  linkStats.busyTime += millis() - startMillis;
+  if (status == DAB_STATUS_OK && cacheable) {
+    cacheStore(dabCommand, dabData, *dabDataSize);
+  }
+  holdQueue = false;
+  idleSince = millis();
+  return status;
+}
+
+/*
+ *  Get one value (1 or 2 bytes) from DAB module
+ */
+DABResult DABDUINO::getValue(byte commandClass, byte commandId, uint8_t valueSize) {
+
+  DABResult result;
+  byte dabData[2];
+  uint32_t dabDataSize;
+  byte dabCommand[7] = { 0xFE, commandClass, commandId, 0x00, 0x00, 0x00, 0xFD };
+  result.status = exchange(dabCommand, dabData, &dabDataSize, sizeof(dabData));
+  result.value = 0;
+  if (result.status == DAB_STATUS_OK) {
+    if (dabDataSize < valueSize) {
+      result.status = DAB_STATUS_SHORT_FRAME;
+    } else if (valueSize == 2) {
+      result.value = ((uint16_t)dabData[0] << 8) + dabData[1];
+    } else {
+      result.value = dabData[0];
+    }
+  }
+  return result;
+}
+
+/*
+ *  Send commands to DAB module pipelined - up to DAB_PIPELINE_DEPTH commands
+ *  are sent before answer of the first one, answers come in the same order.
+ *  After a timed out answer the following answers can not be matched to their
+ *  commands, so the batch stops there: answers of commands already sent are
+ *  drained and the remaining commands fail.
+ *  handler = called for every command with command index and status (1=ok, 0=error)
+ *  return: number of successful commands
+ */
+uint8_t DABDUINO::sendCommands(byte *dabCommands[], uint8_t count, DABResponseHandler handler, void *context) {
+
+  byte dabData[DAB_MAX_DATA_LENGTH];
+  uint32_t dabDataSize;
+  uint8_t sent = 0;
+  uint8_t successful = 0;
+  clearCache();
+  waitIdle();
+  drainSerial();
+  rx.reset();
+  unsigned long startMillis = millis();
+  uint8_t received = 0;
+  for (; received < count; received++) {
+    while (sent < count && sent - received < DAB_PIPELINE_DEPTH) {
+      writeCommand(dabCommands[sent++]);
+    }
+    DABStatus status = receive(dabCommands[received], dabData, &dabDataSize, DAB_MAX_DATA_LENGTH);
+    if (status == DAB_STATUS_TIMEOUT) {
+      break;
+    }
+    successful += (status == DAB_STATUS_OK) ? 1 : 0;
+    if (handler) {
+      handler(context, received, (status == DAB_STATUS_OK) ? 1 : 0, dabData, dabDataSize);
+    }
+  }
+  if (received < count) {
+    for (uint8_t late = received + 1; late < sent; late++) {
+      receive(NULL, dabData, &dabDataSize, DAB_MAX_DATA_LENGTH);
+    }
+    for (; received < count; received++) {
+      if (handler) {
+        handler(context, received, 0, dabData, 0);
+      }
+    }
   }
+  linkStats.busyTime += millis() - startMillis;
+  holdQueue = false;
+  idleSince = millis();
+  return successful;
+}
+
+/*
+ *  Write command to DAB module, command ends with 0xFD
+ */
+void DABDUINO::writeCommand(byte dabCommand[]) {
+
+  linkStats.exchanges++;
+  uint16_t byteIndex = 0;
   while (byteIndex < 255) {
     if (dabCommand[byteIndex++] == 0xFD) break;
   }
   _Serial->write(dabCommand, byteIndex);
   _Serial->flush();
-  byteIndex = 0;
-  unsigned long endMillis = millis() + 200; // timeout for answer from module = 200ms
-  while (millis() < endMillis && dataIndex < DAB_MAX_DATA_LENGTH) {
-    if (_Serial->available() > 0) {
-      serialData = _Serial->read();
-      if (serialData == 0xFE) {
-        byteIndex = 0;
-        dataIndex = 0;
-      }
-      if (*dabDataSize && dataIndex < *dabDataSize) {
-        dabData[dataIndex++] = serialData;
-      }
-      if (byteIndex <= 5) {
-        dabReturn[byteIndex] = serialData;
+  if (tap) {
+    tap(tapContext, DAB_FRAME_TX, micros(), dabCommand, byteIndex);
+  }
+}
+
+/*
+ *  Read available bytes from module up to end of one frame
+ *  return: true=frame complete (in rx)
+ */
+boolean DABDUINO::receiveFrame() {
+
+  while (_Serial->available() > 0) {
+    if (rx.feed(readSerial())) {
+      flushTap();
+      return true;
+    }
+  }
+  flushTap();
+  return false;
+}
+
+/*
+ *  Read one byte from module, keeps it for tap
+ */
+int DABDUINO::readSerial() {
+
+  int serialData = _Serial->read();
+  if (tap && serialData >= 0) {
+    tapChunk[tapChunkLength++] = serialData;
+    if (tapChunkLength == DAB_TAP_CHUNK_LENGTH) {
+      flushTap();
+    }
+  }
+  return serialData;
+}
+
+/*
+ *  Take bytes waiting in serial line - events are queued (see pushEvent),
+ *  stale answers are thrown away
+ */
+void DABDUINO::drainSerial() {
+
+  while (_Serial->available() > 0) {
+    if (rx.feed(readSerial()) && rx.isEvent()) {
+      pushEvent(rx.getId() + 1, rx.getData(), rx.getDataSize());
+    }
+  }
+  flushTap();
+}
+
+/*
+ *  Pass received bytes kept by readSerial to tap
+ */
+void DABDUINO::flushTap() {
+
+  if (tapChunkLength) {
+    if (tap) {
+      tap(tapContext, DAB_FRAME_RX, micros(), tapChunk, tapChunkLength);
+    }
+    tapChunkLength = 0;
+  }
+}
+
+/*
+ *  Set receiver of every frame sent to module and of all bytes received
+ *  from module (e.g. DABLog::tap), NULL=none
+ */
+void DABDUINO::setTap(DABFrameTap tap, void *context) {
+
+  this->tap = tap;
+  tapContext = context;
+}
+
+/*
+ *  Wait for answer of DAB module, events received meanwhile are skipped
+ */
+int8_t DABDUINO::readResponse(byte dabData[], uint32_t *dabDataSize) {
+
+  return (receive(NULL, dabData, dabDataSize, DAB_MAX_DATA_LENGTH) == DAB_STATUS_OK) ? 1 : 0;
+}
+
+/*
+ *  Wait for answer of DAB module, events received meanwhile are skipped
+ *  dabCommand = command of answer, answer of other command (late answer) is
+ *  skipped, NULL=any answer; ACK/NACK can not be matched and are always taken
+ *  dataLength = size of dabData, longer answer is truncated
+ */
+DABStatus DABDUINO::receive(byte dabCommand[], byte dabData[], uint32_t *dabDataSize, uint16_t dataLength) {
+
+  *dabDataSize = 0;
+  unsigned long endMillis = millis() + DAB_COMMAND_TIMEOUT;
+  while (millis() < endMillis) {
+    if (!receiveFrame()) {
+      continue;
+    }
+    if (rx.isEvent()) {
+      pushEvent(rx.getId() + 1, rx.getData(), rx.getDataSize());
+      continue; // wait for answer
+    }
+    if (dabCommand && !isAnswerTo(dabCommand)) {
+      continue; // late answer of timed out command
+    }
+    if (rx.isNack()) {
+      return DAB_STATUS_NACK;
+    }
+    *dabDataSize = (rx.getDataSize() < dataLength) ? rx.getDataSize() : dataLength;
+    memcpy(dabData, rx.getData(), *dabDataSize);
+    return DAB_STATUS_OK;
+  }
+  return DAB_STATUS_TIMEOUT;
+}
+
+// *************************
+// ***** NON-BLOCKING ******
+// *************************
+
+/*
+ *  Drive non-blocking commands: read answers and events received so far,
+ *  finish timed out command and send next queued command.
+ *  Call it from loop() as often as possible.
+ */
+void DABDUINO::poll() {
+
+  while (receiveFrame()) {
+    frameReceived();
+  }
+  if (inFlight && millis() - sentMillis > DAB_COMMAND_TIMEOUT) {
+    requestFinished(0, rx.getData(), 0);
+  }
+  if (!inFlight && !holdQueue) {
+    int8_t priority = selectQueue();
+    if (priority >= 0) {
+      current = queue[priority][queueHead[priority]];
+      currentPriority = priority;
+      queueHead[priority] = (queueHead[priority] + 1) % DAB_QUEUE_LENGTH;
+      queueCount[priority]--;
+      if (!isCacheable(current.command)) {
+        clearCache();
       }
-      if (byteIndex == 5) {
-        *dabDataSize = (((long)dabReturn[4] << 8) + (long)dabReturn[5]);
+      writeCommand(current.command);
+      inFlight = true;
+      sentMillis = millis();
+    }
+  }
+}
+
+/*
+ *  Queue command for non-blocking send (see poll)
+ *  handler = called with answer, index = passed to handler
+ *  priority = DAB_PRIORITY_INTERACTIVE, DAB_PRIORITY_PLAYBACK, DAB_PRIORITY_BACKGROUND
+ *  Getter answered within cache time is passed to handler before return,
+ *  getter identical to queued one shares its answer.
+ *  return: 1=queued, 0=queue is full or command longer than DAB_MAX_COMMAND_LENGTH
+ */
+int8_t DABDUINO::queueCommand(byte dabCommand[], DABResponseHandler handler, void *context, uint8_t index, uint8_t priority) {
+
+  uint8_t length = 0;
+  while (length < DAB_MAX_COMMAND_LENGTH && dabCommand[length] != 0xFD) {
+    length++;
+  }
+  if (length == DAB_MAX_COMMAND_LENGTH) {
+    return 0; // no room for whole command
+  }
+  if (priority >= DAB_PRIORITIES) {
+    priority = DAB_PRIORITY_BACKGROUND;
+  }
+  if (isCacheable(dabCommand)) {
+    byte dabData[DAB_CACHE_DATA_LENGTH];
+    uint32_t dabDataSize;
+    if (cacheLookup(dabCommand, dabData, &dabDataSize, sizeof(dabData))) {
+      if (handler) {
+        handler(context, index, 1, dabData, dabDataSize);
       }
-      if ((int16_t)(byteIndex - *dabDataSize) >= 5 && serialData == 0xFD) {
-        isPacketCompleted = 1;
+      return 1;
+    }
+    if (coalesce(dabCommand, handler, context, index, priority)) {
+      return 1;
+    }
+  }
+  if (queueCount[priority] == DAB_QUEUE_LENGTH) {
+    queueStats[priority].dropped++;
+    return 0;
+  }
+  DABRequest *request = &queue[priority][(queueHead[priority] + queueCount[priority]) % DAB_QUEUE_LENGTH];
+  memcpy(request->command, dabCommand, length + 1);
+  request->handler = handler;
+  request->context = context;
+  request->index = index;
+  if (!++requestId) {
+    requestId = 1; // 0=no request
+  }
+  request->id = requestId;
+  request->queuedMillis = millis();
+  queueCount[priority]++;
+  return 1;
+}
+
+/*
+ *  Get number of queued commands (including command waiting for answer)
+ */
+uint8_t DABDUINO::getQueueLength() {
+
+  uint8_t length = inFlight ? 1 : 0;
+  for (uint8_t i = 0; i < DAB_PRIORITIES; i++) {
+    length += queueCount[i];
+  }
+  return length;
+}
+
+/*
+ *  Get latency statistics of priority
+ */
+const DABQueueStats *DABDUINO::getQueueStats(uint8_t priority) {
+
+  return &queueStats[priority < DAB_PRIORITIES ? priority : DAB_PRIORITY_BACKGROUND];
+}
+
+/*
+ *  Reset latency statistics
+ */
+void DABDUINO::resetQueueStats() {
+
+  memset(queueStats, 0, sizeof(queueStats));
+}
+
+/*
+ *  Select queue of next command: highest priority first, background within
+ *  its rate budget, command waiting over DAB_STARVATION_TIME before all.
+ *  return: priority, -1=nothing to send
+ */
+int8_t DABDUINO::selectQueue() {
+
+  unsigned long now = millis();
+  unsigned long elapsed = now - tokensMillis;
+  if (elapsed > DAB_BACKGROUND_BURST * 1000UL) {
+    elapsed = DAB_BACKGROUND_BURST * 1000UL;
+  }
+  uint32_t tokens = backgroundTokens + elapsed * DAB_BACKGROUND_RATE;
+  backgroundTokens = (tokens < DAB_BACKGROUND_BURST * 1000UL) ? tokens : DAB_BACKGROUND_BURST * 1000UL;
+  tokensMillis = now;
+
+  int8_t selected = -1;
+  for (uint8_t priority = 0; priority < DAB_PRIORITIES; priority++) {
+    if (!queueCount[priority]) continue;
+    if (priority == DAB_PRIORITY_BACKGROUND && backgroundTokens < 1000) continue;
+    if (selected < 0) {
+      selected = priority;
+    } else if (now - queue[priority][queueHead[priority]].queuedMillis > DAB_STARVATION_TIME) {
+      queueStats[priority].promoted++;
+      selected = priority;
+      break;
+    }
+  }
+  if (selected == DAB_PRIORITY_BACKGROUND) {
+    backgroundTokens -= 1000;
+  }
+  return selected;
+}
+
+/*
+ *  Set freshness of cached getter answers
+ *  cacheTime = ms, 0=no cache
+ */
+void DABDUINO::setCacheTime(uint16_t cacheTime) {
+
+  this->cacheTime = cacheTime;
+  clearCache();
+}
+
+/*
+ *  Forget cached getter answers
+ */
+void DABDUINO::clearCache() {
+
+  for (uint8_t i = 0; i < DAB_CACHE_ENTRIES; i++) {
+    cache[i].commandClass = 0xFF;
+  }
+}
+
+/*
+ *  Get serial line statistics
+ */
+const DABLinkStats *DABDUINO::getLinkStats() {
+
+  return &linkStats;
+}
+
+/*
+ *  Share answer of identical command in flight or queued with same or higher priority
+ *  return: 1=handler waits for answer, 0=command must be queued
+ */
+int8_t DABDUINO::coalesce(byte dabCommand[], DABResponseHandler handler, void *context, uint8_t index, uint8_t priority) {
+
+  uint8_t id = 0;
+  if (inFlight && current.command[1] == dabCommand[1] && current.command[2] == dabCommand[2]) {
+    id = current.id;
+  }
+  for (uint8_t p = 0; p <= priority && !id; p++) {
+    for (uint8_t i = 0; i < queueCount[p]; i++) {
+      DABRequest *request = &queue[p][(queueHead[p] + i) % DAB_QUEUE_LENGTH];
+      if (request->command[1] == dabCommand[1] && request->command[2] == dabCommand[2]) {
+        id = request->id;
         break;
       }
-      byteIndex++;
     }
   }
-  if (isPacketCompleted == 1 && !(dabReturn[1] == 0x00 && dabReturn[2] == 0x02)) {
-    return 1;
-  } else {
+  if (!id) return 0;
+  for (uint8_t i = 0; i < DAB_MAX_WAITERS; i++) {
+    if (!waiters[i].used) {
+      waiters[i].handler = handler;
+      waiters[i].context = context;
+      waiters[i].index = index;
+      waiters[i].requestId = id;
+      waiters[i].used = true;
+      linkStats.coalesced++;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ *  Test command is getter without parameters, which answer may be cached and shared
+ */
+boolean DABDUINO::isCacheable(byte dabCommand[]) {
+
+  if (dabCommand[4] || dabCommand[5]) return false;
+  if (dabCommand[1] == 0x01) {
+    switch (dabCommand[2]) {
+    case 0x05: // playStatus
+    case 0x06: // playMode
+    case 0x07: // getPlayIndex
+    case 0x08: // getSignalStrength
+    case 0x0A: // getStereoMode
+    case 0x0B: // getStereoType
+    case 0x0D: // getVolume
+    case 0x0E: // getProgramType
+    case 0x11: // getSamplingRate
+    case 0x12: // getDataRate
+    case 0x13: // getSignalQuality
+    case 0x24: // getProgramSorter
+    case 0x26: // getDRC
+    case 0x2D: // getECC
+    case 0x2E: // getRdsPIcode
+    case 0x36: // getFMseekTreshold
+    case 0x38: // getFMstereoTreshold
+    case 0x39: // getFMexactStation
+      return true;
+    }
+  } else if (dabCommand[1] == 0x02) {
+    switch (dabCommand[2]) {
+    case 0x01: // getRTCclock
+    case 0x03: // getRTCsyncStatus
+    case 0x04: // getRTCclockStatus
+      return true;
+    }
+  }
+  return false;
+}
+
+int8_t DABDUINO::cacheLookup(byte dabCommand[], byte dabData[], uint32_t *dabDataSize, uint16_t dataLength) {
+
+  if (!cacheTime) return 0;
+  for (uint8_t i = 0; i < DAB_CACHE_ENTRIES; i++) {
+    DABCacheEntry *entry = &cache[i];
+    if (entry->commandClass == dabCommand[1] && entry->commandId == dabCommand[2]) {
+      if (millis() - entry->time > cacheTime) {
+        return 0;
+      }
+      *dabDataSize = (entry->dataSize < dataLength) ? entry->dataSize : dataLength;
+      memcpy(dabData, entry->data, *dabDataSize);
+      linkStats.cacheHits++;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void DABDUINO::cacheStore(byte dabCommand[], byte dabData[], uint32_t dabDataSize) {
+
+  if (!cacheTime || dabDataSize > DAB_CACHE_DATA_LENGTH) return;
+  // same command or oldest entry
+  DABCacheEntry *entry = &cache[0];
+  for (uint8_t i = 0; i < DAB_CACHE_ENTRIES; i++) {
+    if (cache[i].commandClass == dabCommand[1] && cache[i].commandId == dabCommand[2]) {
+      entry = &cache[i];
+      break;
+    }
+    if (cache[i].commandClass == 0xFF || millis() - cache[i].time > millis() - entry->time) {
+      entry = &cache[i];
+    }
+  }
+  entry->commandClass = dabCommand[1];
+  entry->commandId = dabCommand[2];
+  entry->dataSize = dabDataSize;
+  memcpy(entry->data, dabData, dabDataSize);
+  entry->time = millis();
+}
+
+/*
+ *  Get time since serial line is idle (ms), 0=command in progress
+ */
+unsigned long DABDUINO::getLinkIdleTime() {
+
+  if (getQueueLength() || holdQueue) {
     return 0;
   }
+  return millis() - idleSince;
+}
+
+/*
+ *  Finish non-blocking command in progress and stop sending queued commands,
+ *  blocking command is going to use serial line
+ */
+void DABDUINO::waitIdle() {
+
+  holdQueue = true;
+  while (inFlight) {
+    poll();
+  }
+}
+
+void DABDUINO::frameReceived() {
+
+  if (rx.isEvent()) {
+    pushEvent(rx.getId() + 1, rx.getData(), rx.getDataSize());
+  } else if (inFlight && isAnswerTo(current.command)) {
+    requestFinished(!rx.isNack(), rx.getData(), rx.getDataSize());
+  }
+}
+
+/*
+ *  Check if received frame answers command - data answers echo class and
+ *  id of command, ACK/NACK (class 0) can not be told apart
+ */
+boolean DABDUINO::isAnswerTo(byte dabCommand[]) {
+
+  return rx.getClass() == 0x00 || (rx.getClass() == dabCommand[1] && rx.getId() == dabCommand[2]);
+}
+
+void DABDUINO::requestFinished(int8_t status, byte dabData[], uint32_t dabDataSize) {
+
+  DABQueueStats *stats = &queueStats[currentPriority];
+  unsigned long latency = millis() - current.queuedMillis;
+  stats->commands++;
+  stats->totalLatency += latency;
+  if (latency > stats->maxLatency) {
+    stats->maxLatency = (latency < 0xFFFF) ? latency : 0xFFFF;
+  }
+  inFlight = false;
+  idleSince = millis();
+  linkStats.busyTime += idleSince - sentMillis;
+  if (status && isCacheable(current.command)) {
+    cacheStore(current.command, dabData, dabDataSize);
+  }
+  if (current.handler) {
+    current.handler(current.context, current.index, status, dabData, dabDataSize);
+  }
+  for (uint8_t i = 0; i < DAB_MAX_WAITERS; i++) {
+    if (waiters[i].used && waiters[i].requestId == current.id) {
+      waiters[i].used = false;
+      if (waiters[i].handler) {
+        waiters[i].handler(waiters[i].context, waiters[i].index, status, dabData, dabDataSize);
+      }
+    }
+  }
+}
+
+void DABDUINO::pushEvent(int8_t type, byte data[], uint32_t dataSize) {
+
+  if (type >= 1 && type <= DAB_EVENT_TYPES) {
+    if (!(eventMask & DAB_EVENT_FLAG(type))) {
+      return; // sent before mask change
+    }
+    if (eventHandlers[type - 1]) {
+      eventHandlers[type - 1](eventContexts[type - 1], type, data, (dataSize < 0xFF) ? dataSize : 0xFF);
+      return;
+    }
+  }
+  if (eventsCount == DAB_EVENT_QUEUE_LENGTH) {
+    // drop oldest event
+    eventsHead = (eventsHead + 1) % DAB_EVENT_QUEUE_LENGTH;
+    eventsCount--;
+  }
+  DABEvent *event = &events[(eventsHead + eventsCount) % DAB_EVENT_QUEUE_LENGTH];
+  event->type = type;
+  event->dataSize = (dataSize < DAB_MAX_EVENT_DATA_LENGTH) ? dataSize : DAB_MAX_EVENT_DATA_LENGTH;
+  memcpy(event->data, data, event->dataSize);
+  eventsCount++;
 }
 
 // *************************
@@ -335,6 +956,10 @@ int8_t DABDUINO::playDAB(uint32_t programIndex) {
   byte Byte3 = ((programIndex >> 24) & 0xFF);
   byte dabCommand[12] = { 0xFE, 0x01, 0x00, 0x00, 0x00, 0x05, 0x00, Byte3, Byte2, Byte1, Byte0, 0xFD };
   if (sendCommand(dabCommand, dabData, &dabDataSize)) {
+    textHash = 0;
+    textServiceKey = programIndex;
+    playingMode = 0;
+    playingIndex = programIndex;
     return 1;
   } else {
     return 0;
@@ -355,6 +980,10 @@ int8_t DABDUINO::playFM(uint32_t frequency) {
   byte Byte3 = ((frequency >> 24) & 0xFF);
   byte dabCommand[12] = { 0xFE, 0x01, 0x00, 0x00, 0x00, 0x05, 0x01, Byte3, Byte2, Byte1, Byte0, 0xFD };
   if (sendCommand(dabCommand, dabData, &dabDataSize)) {
+    textHash = 0;
+    textServiceKey = DAB_TEXT_KEY_FM | frequency;
+    playingMode = 1;
+    playingIndex = frequency;
     return 1;
   } else {
     return 0;
@@ -370,6 +999,8 @@ int8_t DABDUINO::playBEEP() {
   uint32_t dabDataSize;
   byte dabCommand[12] = { 0xFE, 0x01, 0x00, 0x00, 0x00, 0x05, 0x02, 0x00, 0x00, 0x00, 0x00, 0xFD };
   if (sendCommand(dabCommand, dabData, &dabDataSize)) {
+    playingMode = 2;
+    playingIndex = 0;
     return 1;
   } else {
     return 0;
@@ -385,15 +1016,105 @@ int8_t DABDUINO::playSTOP() {
   uint32_t dabDataSize;
   byte dabCommand[7] = { 0xFE, 0x01, 0x01, 0x00, 0x00, 0x00, 0xFD };
   if (sendCommand(dabCommand, dabData, &dabDataSize)) {
+    playingMode = 255;
+    playingIndex = 0;
     return 1;
   } else {
     return 0;
   }
 }
 
+/*
+ *   Tune DAB program or FM station with muted DAC
+ *   mode = 0=DAB, 1=FM
+ *   programIndex = DAB: programIndex, FM: frequency
+ *   Module has no "playing" event - audio is up on first event of new program
+ *   (text, RDS) or when play status says playing, whichever comes first.
+ *   Status and events count only after play status left playing once, before
+ *   that they may still belong to program played before; status playing from
+ *   play command for DAB_TUNE_SETTLE means module switched between polls.
+ *   Time to audio is returned by getTuneTime().
+ *   return: 1=playing, 0=error or timeout
+ */
+int8_t DABDUINO::tune(uint8_t mode, uint32_t programIndex) {
+
+  unsigned long startMillis = millis();
+  uint32_t status;
+  int8_t playing = 0;
+  boolean left = false; // play status left playing of program before
+  setMute(true);
+  if (mode == 1 ? playFM(programIndex) : playDAB(programIndex)) {
+    unsigned long pollMillis = millis() - DAB_TUNE_POLL; // first poll at once
+    while (!playing && millis() - startMillis < DAB_TUNE_TIMEOUT) {
+      if (receiveFrame()) {
+        // event stays queued for application (see getEvent, readEvent)
+        if (left && rx.isEvent()) {
+          switch (rx.getId() + 1) {
+          case 2: // new DAB program text
+          case 5: // RDS group
+          case 6: // new FM radio text
+            playing = 1;
+            break;
+          }
+        }
+        frameReceived();
+      } else if (millis() - pollMillis >= DAB_TUNE_POLL) {
+        pollMillis = millis();
+        clearCache(); // status from module, not cached answer of poll before
+        if (playStatus(&status)) {
+          if (status != 0) {
+            left = true;
+          } else if (left || millis() - startMillis >= DAB_TUNE_SETTLE) {
+            playing = 1; // playing for settle time at every poll = switched between polls
+          }
+        }
+      }
+    }
+  }
+  setMute(false);
+  tuneTime = millis() - startMillis;
+  return playing;
+}
+
+/*
+ *   Get time of last tune() from command to audio (ms)
+ */
+unsigned long DABDUINO::getTuneTime() {
+
+  return tuneTime;
+}
+
+/*
+ *   Get play mode set by last playDAB/playFM/playBEEP/playSTOP/tune (and
+ *   searchDAB/searchFM), kept without module round trip. Play commands
+ *   queued by application (see queueCommand) are not tracked.
+ *   return: 0=DAB, 1=FM, 2=BEEP, 255=Stream stop (as playMode)
+ */
+uint8_t DABDUINO::getPlayingMode() {
+
+  return playingMode;
+}
+
+/*
+ *   Get program index (DAB) or frequency (FM) of getPlayingMode,
+ *   0=unknown (FM seek, stop)
+ */
+uint32_t DABDUINO::getPlayingIndex() {
+
+  return playingIndex;
+}
+
+/*
+ *   Mute DAC (cinch) output
+ */
+void DABDUINO::setMute(boolean mute) {
+
+  digitalWrite(dacMutePin, mute ? LOW : HIGH);
+}
+
 /*
  * Search DAB bands for programs
- * zone: 1=BAND-3, 2=CHINA-BAND, 3=L-BAND
+ * zone: 1=BAND-3 (DAB_BAND_3), 2=CHINA-BAND (DAB_CHINA_BAND), 3=L-BAND (DAB_L_BAND)
  */
 
 int8_t DABDUINO::searchDAB(uint32_t band = 1) {
@@ -401,26 +1122,17 @@ int8_t DABDUINO::searchDAB(uint32_t band = 1) {
   byte dabData[DAB_MAX_DATA_LENGTH];
   uint32_t dabDataSize;
 
-  byte chStart = 0;
-  byte chEnd = 40;
-
-  switch (band) {
-  case 1:
-    chStart = 0;
-    chEnd = 40;
-    break;
-  case 2:
-    chStart = 41;
-    chEnd = 71;
-    break;
-  case 3:
-    chStart = 72;
-    chEnd = 94;
-    break;
+  byte chStart = DABChannels::first(DAB_BAND_3);
+  byte chEnd = DABChannels::last(DAB_BAND_3);
+  if (band == DAB_CHINA_BAND || band == DAB_L_BAND) {
+    chStart = DABChannels::first(band);
+    chEnd = DABChannels::last(band);
   }
 
   byte dabCommand[9] = { 0xFE, 0x01, 0x03, 0x00, 0x00, 0x02, chStart, chEnd, 0xFD };
   if (sendCommand(dabCommand, dabData, &dabDataSize)) {
+    playingMode = 255; // search stops stream
+    playingIndex = 0;
     return 1;
   } else {
     return 0;
@@ -438,57 +1150,174 @@ int8_t DABDUINO::searchFM(uint32_t searchDirection) {
   if (searchDirection > 1) searchDirection = 1;
   byte dabCommand[8] = { 0xFE, 0x01, 0x02, 0x00, 0x00, 0x01, searchDirection, 0xFD };
   if (sendCommand(dabCommand, dabData, &dabDataSize)) {
+    textHash = 0;
+    textServiceKey = DAB_TEXT_KEY_FM; // seek stop is unknown
+    playingMode = 1;
+    playingIndex = 0;
     return 1;
   } else {
     return 0;
   }
 }
 
+/*
+ * Scan whole FM band (87.5 - 108MHz) in one pass
+ * Every seek stop is taken from "scanning frequency" events (event 7), so no
+ * playStatus/getPlayIndex polling is needed per station.
+ * stations = array for found stations, sorted by frequency
+ * stationsSize = size of stations array
+ * withRDS = capture RDS PI code and PS name of every found station too
+ * return: number of found stations
+ */
+uint8_t DABDUINO::scanFM(DABFMStation stations[], uint8_t stationsSize, boolean withRDS) {
+
+  uint8_t found = 0;
+  uint32_t lastFrequency = 0;
+  uint32_t signalStrength;
+  uint32_t bitErrorRate;
+  uint16_t lastMask = eventMask;
+  boolean lastMaskKnown = eventMaskKnown;
+  DABEventHandler lastHandler = eventHandlers[7 - 1];
+
+  // only scanning frequency events, RDS is read by getRDSrawData
+  if (!setEventMask(DAB_EVENT_SCAN_FREQUENCY)) return 0;
+  // scanning frequency events are read here, not by handler
+  eventHandlers[7 - 1] = NULL;
+  if (!playFM(87500)) {
+    eventHandlers[7 - 1] = lastHandler;
+    setEventMask(lastMaskKnown ? lastMask : DAB_EVENT_ALL);
+    return 0;
+  }
+
+  // seek stops above tuned frequency only, station on band start is taken by its signal
+  uint32_t frequency = 0;
+  uint32_t seekThreshold;
+  delay(DAB_FM_SIGNAL_SETTLE);
+  if (getFMseekTreshold(&seekThreshold) && getSignalStrength(&signalStrength, &bitErrorRate)
+      && signalStrength >= seekThreshold) {
+    frequency = 87500;
+  }
+
+  while (found < stationsSize) {
+    if (!frequency) {
+      if (!searchFM(1)) break;
+
+      // seek is finished when module stops reporting scanning frequency
+      unsigned long startMillis = millis();
+      unsigned long lastEventMillis = startMillis;
+      while (millis() - startMillis < DAB_FM_SEEK_TIMEOUT) {
+        if (isEvent()) {
+          if (readEvent() == 7 && eventDataSize) {
+            frequency = 0;
+            for (uint32_t i = 0; i < eventDataSize && i < 4; i++) {
+              frequency = (frequency << 8) + eventData[i];
+            }
+            lastEventMillis = millis();
+          }
+        } else if (frequency && millis() - lastEventMillis > DAB_FM_SEEK_SETTLE) {
+          break;
+        }
+      }
+
+      // no stop or seek wrapped around band end
+      if (frequency == 0 || frequency <= lastFrequency) break;
+    }
+    lastFrequency = frequency;
+
+    // seek goes up only, so stations come sorted by frequency
+    DABFMStation *station = &stations[found++];
+
+    station->frequency = frequency;
+    station->signalStrength = 0;
+    station->piCode = 0;
+    station->psName[0] = 0x00;
+    if (getSignalStrength(&signalStrength, &bitErrorRate)) {
+      station->signalStrength = signalStrength;
+    }
+    if (withRDS) {
+      getStationRDS(station);
+    }
+    if (frequency >= 108000) break;
+    frequency = 0;
+  }
+  eventHandlers[7 - 1] = lastHandler;
+  // mask never set by application: all events as eventNotificationEnable
+  setEventMask(lastMaskKnown ? lastMask : DAB_EVENT_ALL);
+  return found;
+}
+
+/*
+ * Capture RDS PI code and PS name (group 0A/0B) of tuned FM station
+ * return: 1=complete PS name received, 0=timeout
+ */
+int8_t DABDUINO::getStationRDS(DABFMStation *station) {
+
+  uint32_t piCode;
+  uint32_t block[4];
+  uint32_t bler[4];
+  byte segments = 0;
+  char psName[DAB_FM_PS_LENGTH + 1];
+
+  memset(psName, ' ', DAB_FM_PS_LENGTH);
+  psName[DAB_FM_PS_LENGTH] = 0x00;
+  unsigned long startMillis = millis();
+  while (millis() - startMillis < DAB_FM_RDS_TIMEOUT) {
+    if (getRDSrawData(&block[0], &block[1], &block[2], &block[3], &bler[0], &bler[1], &bler[2], &bler[3]) == 1) {
+      // group type 0 (A or B) carries two PS chars in block D
+      if (((block[1] >> 12) & 0x0F) == 0 && bler[1] == 0 && bler[3] == 0) {
+        byte segment = block[1] & 0x03;
+        psName[segment * 2] = (char)charToAscii(0x00, (block[3] >> 8) & 0xFF);
+        psName[segment * 2 + 1] = (char)charToAscii(0x00, block[3] & 0xFF);
+        segments |= (1 << segment);
+      }
+      if (segments == 0x0F) break;
+    } else {
+      delay(10);
+    }
+  }
+  if (getRdsPIcode(&piCode)) {
+    station->piCode = piCode;
+  }
+  memcpy(station->psName, psName, sizeof(psName));
+  return (segments == 0x0F) ? 1 : 0;
+}
+
 /*
  *   Radio module play status
  *   return data: 0=playing, 1=searching, 2=tuning, 3=stop, 4=sorting change, 5=reconfiguration
  */
+DABResult DABDUINO::playStatus() {
+
+  return getValue(0x01, 0x05, 1);
+}
+
 int8_t DABDUINO::playStatus(uint32_t *data) {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
-  uint32_t dabDataSize;
-  byte dabCommand[7] = { 0xFE, 0x01, 0x05, 0x00, 0x00, 0x00, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    if (dabDataSize) {
-      *data = (uint32_t)dabData[0];
-      return 1;
-    } else {
-      return 0;
-    }
-  } else {
-    return 0;
+  DABResult result = playStatus();
+  if (result.status == DAB_STATUS_OK) {
+    *data = result.value;
+    return 1;
   }
+  return 0;
 }
 
 /*
  *   Radio module play mode
  *   return data: 0=DAB, 1=FM, 2=BEEP, 255=Stream stop
  */
+DABResult DABDUINO::playMode() {
+
+  return getValue(0x01, 0x06, 1);
+}
+
 int8_t DABDUINO::playMode(uint32_t *data) {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
-  uint32_t dabDataSize;
-  byte dabCommand[7] = { 0xFE, 0x01, 0x06, 0x00, 0x00, 0x00, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    if (dabDataSize) {
-      if (dabData[0] != 0xFF) {
-        *data = (uint32_t)dabData[0];
-        return 1;
-      } else {
-        *data = (uint32_t)dabData[0];
-        return 1;
-      }
-    } else {
-      return 0;
-    }
-  } else {
-    return 0;
+  DABResult result = playMode();
+  if (result.status == DAB_STATUS_OK) {
+    *data = result.value;
+    return 1;
   }
+  return 0;
 }
 
 /*
@@ -510,26 +1339,146 @@ int8_t DABDUINO::getPlayIndex(uint32_t *data) {
   }
 }
 
+/*
+ * Snapshot field query commands, indexed by DAB_SNAPSHOT_* field
+ */
+static const byte snapshotCommands[DAB_SNAPSHOT_FIELDS] = { 0x06, 0x05, 0x07, 0x08, 0x13, 0x0B, 0x11, 0x12, 0x0E, 0x0D };
+
+struct DABSnapshotRequest
+{
+  DABPlaybackSnapshot *snapshot;
+  uint8_t fields[DAB_SNAPSHOT_FIELDS]; // field of every pipelined command
+  unsigned long millis;
+};
+
+/*
+ * Fields worth querying in play mode (bitmask of DAB_SNAPSHOT_* fields)
+ */
+static uint16_t snapshotFields(uint8_t playMode) {
+
+  uint16_t fields = (1 << DAB_SNAPSHOT_PLAY_MODE) | (1 << DAB_SNAPSHOT_PLAY_STATUS) | (1 << DAB_SNAPSHOT_VOLUME);
+  if (playMode == 0 || playMode == 1) {
+    fields |= (1 << DAB_SNAPSHOT_PLAY_INDEX) | (1 << DAB_SNAPSHOT_SIGNAL_STRENGTH) | (1 << DAB_SNAPSHOT_SAMPLING_RATE);
+  }
+  if (playMode == 0) {
+    fields |= (1 << DAB_SNAPSHOT_SIGNAL_QUALITY) | (1 << DAB_SNAPSHOT_STEREO_TYPE) | (1 << DAB_SNAPSHOT_DATA_RATE) | (1 << DAB_SNAPSHOT_PROGRAM_TYPE);
+  }
+  return fields;
+}
+
+static void snapshotResponse(void *context, uint8_t index, int8_t status, byte dabData[], uint32_t dabDataSize) {
+
+  DABSnapshotRequest *request = (DABSnapshotRequest *)context;
+  DABPlaybackSnapshot *snapshot = request->snapshot;
+  uint8_t field = request->fields[index];
+  if (!status || dabDataSize < 1) {
+    return;
+  }
+  switch (field) {
+  case DAB_SNAPSHOT_PLAY_MODE: snapshot->playMode = dabData[0]; break;
+  case DAB_SNAPSHOT_PLAY_STATUS: snapshot->playStatus = dabData[0]; break;
+  case DAB_SNAPSHOT_PLAY_INDEX:
+    if (dabDataSize < 4) return;
+    snapshot->playIndex = (((uint32_t)dabData[0] << 24) + ((uint32_t)dabData[1] << 16) + ((uint32_t)dabData[2] << 8) + (uint32_t)dabData[3]);
+    break;
+  case DAB_SNAPSHOT_SIGNAL_STRENGTH:
+    snapshot->signalStrength = dabData[0];
+    snapshot->bitErrorRate = (dabDataSize > 2) ? ((uint16_t)dabData[1] << 8) + dabData[2] : 0;
+    break;
+  case DAB_SNAPSHOT_SIGNAL_QUALITY: snapshot->signalQuality = dabData[0]; break;
+  case DAB_SNAPSHOT_STEREO_TYPE: snapshot->stereoType = dabData[0]; break;
+  case DAB_SNAPSHOT_SAMPLING_RATE: snapshot->samplingRate = dabData[0]; break;
+  case DAB_SNAPSHOT_DATA_RATE:
+    if (dabDataSize < 2) return;
+    snapshot->dataRate = ((uint16_t)dabData[0] << 8) + dabData[1];
+    break;
+  case DAB_SNAPSHOT_PROGRAM_TYPE: snapshot->programType = dabData[0]; break;
+  case DAB_SNAPSHOT_VOLUME: snapshot->volume = dabData[0]; break;
+  }
+  snapshot->updated[field] = request->millis;
+}
+
+/*
+ * Get all playback state at once - queries are pipelined, fields not used
+ * in play mode of previous snapshot are skipped (snapshot never updated =
+ * all fields queried). Fields not queried or failed keep value and time.
+ * snapshot = previous snapshot, zero it before first use
+ * return: 1=all queried fields updated, 0=error
+ */
+int8_t DABDUINO::getPlaybackSnapshot(DABPlaybackSnapshot *snapshot) {
+
+  byte dabCommands[DAB_SNAPSHOT_FIELDS][7];
+  byte *commands[DAB_SNAPSHOT_FIELDS];
+  DABSnapshotRequest request;
+  uint16_t queried = 0;
+  uint16_t wanted = (1 << DAB_SNAPSHOT_FIELDS) - 1;
+  int8_t result = 1;
+  request.snapshot = snapshot;
+  if (snapshot->updated[DAB_SNAPSHOT_PLAY_MODE]) {
+    wanted = snapshotFields(snapshot->playMode);
+  }
+  while (wanted & ~queried) {
+    uint8_t count = 0;
+    for (uint8_t field = 0; field < DAB_SNAPSHOT_FIELDS; field++) {
+      if ((wanted & ~queried) & (1 << field)) {
+        byte dabCommand[7] = { 0xFE, 0x01, snapshotCommands[field], 0x00, 0x00, 0x00, 0xFD };
+        memcpy(dabCommands[count], dabCommand, sizeof(dabCommand));
+        commands[count] = dabCommands[count];
+        request.fields[count++] = field;
+      }
+    }
+    queried |= wanted;
+    request.millis = millis();
+    if (request.millis == 0) {
+      request.millis = 1;
+    }
+    if (sendCommands(commands, count, snapshotResponse, &request) != count) {
+      result = 0;
+    }
+    // play mode changed - query fields of new mode not yet queried
+    if (snapshot->updated[DAB_SNAPSHOT_PLAY_MODE] == request.millis) {
+      wanted = snapshotFields(snapshot->playMode);
+    }
+  }
+  return result;
+}
+
 /*
  * Get signal strength
  * DAB: signalStrength=0..18, bitErrorRate=
  * FM: signalStrength=0..100
  */
-int8_t DABDUINO::getSignalStrength(uint32_t *signalStrength, uint32_t *bitErrorRate) {
+DABSignalInfo DABDUINO::getSignalStrength() {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
+  DABSignalInfo result;
+  byte dabData[3];
   uint32_t dabDataSize;
   byte dabCommand[7] = { 0xFE, 0x01, 0x08, 0x00, 0x00, 0x00, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    *signalStrength = (uint32_t)dabData[0];
-    *bitErrorRate = 0;
-    if (dabDataSize > 1) {
-      *bitErrorRate =  (((long)dabData[1] << 8) + (long)dabData[2]);
+  result.status = exchange(dabCommand, dabData, &dabDataSize, sizeof(dabData));
+  result.strength = 0;
+  result.bitErrorRate = 0;
+  if (result.status == DAB_STATUS_OK) {
+    if (dabDataSize < 1) {
+      result.status = DAB_STATUS_SHORT_FRAME;
+    } else {
+      result.strength = dabData[0];
+      if (dabDataSize > 2) {
+        result.bitErrorRate = ((uint16_t)dabData[1] << 8) + dabData[2];
+      }
     }
+  }
+  return result;
+}
+
+int8_t DABDUINO::getSignalStrength(uint32_t *signalStrength, uint32_t *bitErrorRate) {
+
+  DABSignalInfo result = getSignalStrength();
+  if (result.status == DAB_STATUS_OK) {
+    *signalStrength = result.strength;
+    *bitErrorRate = result.bitErrorRate;
     return 1;
-  } else {
-    return 0;
   }
+  return 0;
 }
 
 /*
@@ -556,42 +1505,38 @@ int8_t DABDUINO::setStereoMode(boolean stereo = true) {
  *   Get stereo mode
  *   0=force mono, 1=auto detect stereo
  */
+DABResult DABDUINO::getStereoMode() {
+
+  return getValue(0x01, 0x0A, 1);
+}
+
 int8_t DABDUINO::getStereoMode(uint32_t *data) {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
-  uint32_t dabDataSize;
-  byte dabCommand[7] = { 0xFE, 0x01, 0x0A, 0x00, 0x00, 0x00, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    if (dabDataSize) {
-      *data = (uint32_t)dabData[0];
-      return 1;
-    } else {
-      return 0;
-    }
-  } else {
-    return 0;
+  DABResult result = getStereoMode();
+  if (result.status == DAB_STATUS_OK) {
+    *data = result.value;
+    return 1;
   }
+  return 0;
 }
 
 /*
  *   Get stereo type
  *   return data: 0=stereo, 1=join stereo, 2=dual channel, 3=single channel (mono)
  */
+DABResult DABDUINO::getStereoType() {
+
+  return getValue(0x01, 0x0B, 1);
+}
+
 int8_t DABDUINO::getStereoType(uint32_t *data) {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
-  uint32_t dabDataSize;
-  byte dabCommand[7] = { 0xFE, 0x01, 0x0B, 0x00, 0x00, 0x00, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    if (dabDataSize) {
-      *data = (uint32_t)dabData[0];
-      return 1;
-    } else {
-      return 0;
-    }
-  } else {
-    return 0;
+  DABResult result = getStereoType();
+  if (result.status == DAB_STATUS_OK) {
+    *data = result.value;
+    return 1;
   }
+  return 0;
 }
 
 /*
@@ -616,42 +1561,38 @@ int8_t DABDUINO::setVolume(uint32_t volumeLevel) {
  *   Get volume
  *   return set volumeLevel: 0..16
  */
+DABResult DABDUINO::getVolume() {
+
+  return getValue(0x01, 0x0D, 1);
+}
+
 int8_t DABDUINO::getVolume(uint32_t *data) {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
-  uint32_t dabDataSize;
-  byte dabCommand[7] = { 0xFE, 0x01, 0x0D, 0x00, 0x00, 0x00, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    if (dabDataSize) {
-      *data = (uint32_t)dabData[0];
-      return 1;
-    } else {
-      return 0;
-    }
-  } else {
-    return 0;
+  DABResult result = getVolume();
+  if (result.status == DAB_STATUS_OK) {
+    *data = result.value;
+    return 1;
   }
+  return 0;
 }
 
 /*
  *   Get program type
  *   0=N/A, 1=News, 2=Curent Affairs, 3=Information, 4=Sport, 5=Education, 6=Drama, 7=Arts, 8=Science, 9=Talk, 10=Pop music, 11=Rock music, 12=Easy listening, 13=Light Classical, 14=Classical music, 15=Other music, 16=Weather, 17=Finance, 18=Children's, 19=Factual, 20=Religion, 21=Phone in, 22=Travel, 23=Leisure, 24=Jazz & Blues, 25=Country music, 26=National music, 27=Oldies music, 28=Folk Music, 29=Documentary, 30=undefined, 31=undefined
  */
+DABResult DABDUINO::getProgramType() {
+
+  return getValue(0x01, 0x0E, 1);
+}
+
 int8_t DABDUINO::getProgramType(uint32_t *data) {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
-  uint32_t dabDataSize;
-  byte dabCommand[7] = { 0xFE, 0x01, 0x0E, 0x00, 0x00, 0x00, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    if (dabDataSize) {
-      *data = (uint32_t)dabData[0];
-      return 1;
-    } else {
-      return 0;
-    }
-  } else {
-    return 0;
+  DABResult result = getProgramType();
+  if (result.status == DAB_STATUS_OK) {
+    *data = result.value;
+    return 1;
   }
+  return 0;
 }
 
 /*
@@ -703,76 +1644,96 @@ int8_t DABDUINO::getProgramLongName(uint32_t programIndex, char text[]) {
 /*
  * Get DAB text event
  * return: 1=new text, 2=text is same, 3=no text
- * dabText: text
+ * dabText: text (untouched when text is same)
+ * Unchanged text is detected by hash of raw module data, before any conversion.
+ * New texts are stored to text cache (see setTextCache) under current program.
  */
 int8_t DABDUINO::getProgramText(char text[]) {
 
-  char textLast[DAB_MAX_TEXT_LENGTH];
-  memcpy(textLast, text, sizeof(text[0])*DAB_MAX_TEXT_LENGTH);
   byte dabData[DAB_MAX_DATA_LENGTH];
   uint32_t dabDataSize;
   byte dabCommand[7] = { 0xFE, 0x01, 0x10, 0x00, 0x00, 0x00, 0xFD };
   if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    if (dabDataSize == 1) {
-      text[0] = dabData[0]; // 0=There is no text in programe, 1=The program text received, but no text available
-      text[1] = 0x00;
-      return 3; // No error, but no text
-    }
-    int32_t j = 0;
-    for (uint32_t i = 0; i < dabDataSize; i = i + 2) {
-      text[j++] = (char)charToAscii(dabData[i], dabData[i + 1]);
-    }
-    for (uint32_t i = 0; i < j; i++) {
-      if (text[i] != textLast[i]) {
-        return 1; // New dab text
-      }
-    }
-    return 2; // Same dab text
+    return decodeProgramText(dabData, dabDataSize, text);
   } else {
     return 0;
   }
 }
 
+/*
+ * Decode answer of program text command (see getProgramText), e.g. fetched by queueCommand
+ * return: 1=new text, 2=same text (text untouched), 3=no text
+ */
+int8_t DABDUINO::decodeProgramText(byte dabData[], uint32_t dabDataSize, char text[]) {
+
+  if (dabDataSize <= 1) {
+    text[0] = dabDataSize ? dabData[0] : 0; // 0=There is no text in programe, 1=The program text received, but no text available
+    text[1] = 0x00;
+    textHash = 0;
+    return 3; // No error, but no text
+  }
+  uint32_t hash = DABTextCache::hash(dabData, dabDataSize);
+  if (hash == textHash) {
+    return 2; // Same dab text
+  }
+  textHash = hash;
+  uint32_t j = 0;
+  for (uint32_t i = 0; i < dabDataSize && j < DAB_MAX_TEXT_LENGTH - 1; i = i + 2) {
+    text[j++] = (char)charToAscii(dabData[i], dabData[i + 1]);
+  }
+  text[j] = 0x00;
+  if (textCache) {
+    textCache->store(textServiceKey, hash, text);
+  }
+  return 1; // New dab text
+}
+
+/*
+ * Set DAB text cache
+ * cache = cache for last texts of every program, NULL=no cache
+ * Texts are stored by program index (DAB) or frequency | DAB_TEXT_KEY_FM (FM).
+ */
+void DABDUINO::setTextCache(DABTextCache *cache) {
+
+  textCache = cache;
+}
+
 /*
  *   Get sampling rate (DAB/FM)
  *   return data: 1=32kHz, 2=24kHz, 3=48kHz
  */
+DABResult DABDUINO::getSamplingRate() {
+
+  return getValue(0x01, 0x11, 1);
+}
+
 int8_t DABDUINO::getSamplingRate(uint32_t *data) {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
-  uint32_t dabDataSize;
-  byte dabCommand[7] = { 0xFE, 0x01, 0x11, 0x00, 0x00, 0x00, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    if (dabDataSize) {
-      *data = (uint32_t)dabData[0];
-      return 1;
-    } else {
-      return 0;
-    }
-  } else {
-    return 0;
+  DABResult result = getSamplingRate();
+  if (result.status == DAB_STATUS_OK) {
+    *data = result.value;
+    return 1;
   }
+  return 0;
 }
 
 /*
  *   Get data rate (DAB)
  *   return data: data rate in kbps
  */
+DABResult DABDUINO::getDataRate() {
+
+  return getValue(0x01, 0x12, 2);
+}
+
 int8_t DABDUINO::getDataRate(uint32_t *data) {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
-  uint32_t dabDataSize;
-  byte dabCommand[7] = { 0xFE, 0x01, 0x12, 0x00, 0x00, 0x00, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    if (dabDataSize) {
-      *data = (((long)dabData[0] << 8) + (long)dabData[1]);
-      return 1;
-    } else {
-      return 0;
-    }
-  } else {
-    return 0;
+  DABResult result = getDataRate();
+  if (result.status == DAB_STATUS_OK) {
+    *data = result.value;
+    return 1;
   }
+  return 0;
 }
 
 /*
@@ -782,29 +1743,26 @@ int8_t DABDUINO::getDataRate(uint32_t *data) {
  *   20..30 = the noise (short break) appears
  *   100 = the bit error rate is 0
  */
+DABResult DABDUINO::getSignalQuality() {
+
+  return getValue(0x01, 0x13, 1);
+}
+
 int8_t DABDUINO::getSignalQuality(uint32_t *data) {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
-  uint32_t dabDataSize;
-  byte dabCommand[7] = { 0xFE, 0x01, 0x13, 0x00, 0x00, 0x00, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    if (dabDataSize) {
-      *data = (uint32_t)dabData[0];
-      return 1;
-    } else {
-      return 0;
-    }
-  } else {
-    return 0;
+  DABResult result = getSignalQuality();
+  if (result.status == DAB_STATUS_OK) {
+    *data = result.value;
+    return 1;
   }
+  return 0;
 }
 
 /*
  *   Get DAB frequency for program index
  *   return: frequency index
  *   0=174.928MHz, 1=176.64, 2=178.352,...
- *
- *  // TODO: add conversion table for index2freqency
+ *   (see DABChannels for label and frequency)
  */
 int8_t DABDUINO::getFrequency(uint32_t programIndex, uint32_t *data) {
 
@@ -1114,20 +2072,19 @@ int8_t DABDUINO::setProgramSorter(uint32_t sortMethod) {
  * Get DRC
  * return data = 0=DRC off, 1=DRC low, 2=DRC high
  */
+DABResult DABDUINO::getDRC() {
+
+  return getValue(0x01, 0x26, 1);
+}
+
 int8_t DABDUINO::getDRC(uint32_t *data) {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
-  uint32_t dabDataSize;
-  byte dabCommand[7] = { 0xFE, 0x01, 0x26, 0x00, 0x00, 0x00, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    if (dabDataSize) {
-      *data = (uint32_t)dabData[0];
-      return 1;
-    }
-    return 0;
-  } else {
-    return 0;
+  DABResult result = getDRC();
+  if (result.status == DAB_STATUS_OK) {
+    *data = result.value;
+    return 1;
   }
+  return 0;
 }
 
 /*
@@ -1248,35 +2205,65 @@ int8_t DABDUINO::getFMstereoThdLevel(uint32_t *data) {
 
 /*
  * Get RDS raw data
- * return: 1=new RDS data, 2=no new RDS data, 3=no RDS data
+ * return state: 1=new RDS data, 2=no new RDS data, 3=no RDS data
  */
-int8_t DABDUINO::getRDSrawData(uint32_t *RDSblockA, uint32_t *RDSblockB, uint32_t *RDSblockC, uint32_t *RDSblockD, uint32_t *BlerA, uint32_t *BlerB, uint32_t *BlerC, uint32_t *BlerD) {
+DABRdsGroup DABDUINO::getRDSrawData() {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
+  DABRdsGroup result;
+  byte dabData[16];
   uint32_t dabDataSize;
   byte dabCommand[7] = { 0xFE, 0x01, 0x32, 0x00, 0x00, 0x00, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    if (dabDataSize > 1) {
-      *RDSblockA = (((long)dabData[0] << 8) + (long)dabData[1]);
-      *RDSblockB = (((long)dabData[2] << 8) + (long)dabData[3]);
-      *RDSblockC = (((long)dabData[4] << 8) + (long)dabData[5]);
-      *RDSblockD = (((long)dabData[6] << 8) + (long)dabData[7]);
-      *BlerA = (((long)dabData[8] << 8) + (long)dabData[9]);
-      *BlerB = (((long)dabData[10] << 8) + (long)dabData[11]);
-      *BlerC = (((long)dabData[12] << 8) + (long)dabData[13]);
-      *BlerD = (((long)dabData[14] << 8) + (long)dabData[15]);
-      return 1;
-    } else {
-      if (dabData[0] == 1) {
-        return 2;
-      } else {
-        return 3;
-      }
+  DABStatus status = exchange(dabCommand, dabData, &dabDataSize, sizeof(dabData));
+  if (status == DAB_STATUS_OK) {
+    decodeRDSrawData(dabData, dabDataSize, &result);
+  } else {
+    memset(&result, 0, sizeof(result));
+    result.status = status;
+  }
+  return result;
+}
+
+/*
+ * Decode answer of RDS raw data command (see getRDSrawData)
+ */
+void DABDUINO::decodeRDSrawData(byte dabData[], uint32_t dabDataSize, DABRdsGroup *group) {
+
+  memset(group, 0, sizeof(DABRdsGroup));
+  group->status = DAB_STATUS_OK;
+  if (dabDataSize >= 16) {
+    for (uint8_t i = 0; i < 4; i++) {
+      group->block[i] = ((uint16_t)dabData[2 * i] << 8) + dabData[2 * i + 1];
+      group->bler[i] = ((uint16_t)dabData[8 + 2 * i] << 8) + dabData[8 + 2 * i + 1];
     }
-    return 0;
+    group->state = 1;
+  } else if (dabDataSize > 1) {
+    group->status = DAB_STATUS_SHORT_FRAME;
   } else {
+    group->state = (dabDataSize && dabData[0] == 1) ? 2 : 3;
+  }
+}
+
+/*
+ * Get RDS raw data
+ * return: 1=new RDS data, 2=no new RDS data, 3=no RDS data
+ */
+int8_t DABDUINO::getRDSrawData(uint32_t *RDSblockA, uint32_t *RDSblockB, uint32_t *RDSblockC, uint32_t *RDSblockD, uint32_t *BlerA, uint32_t *BlerB, uint32_t *BlerC, uint32_t *BlerD) {
+
+  DABRdsGroup result = getRDSrawData();
+  if (result.status != DAB_STATUS_OK) {
     return 0;
   }
+  if (result.state == 1) {
+    *RDSblockA = result.block[0];
+    *RDSblockB = result.block[1];
+    *RDSblockC = result.block[2];
+    *RDSblockD = result.block[3];
+    *BlerA = result.bler[0];
+    *BlerB = result.bler[1];
+    *BlerC = result.bler[2];
+    *BlerD = result.bler[3];
+  }
+  return result.state;
 }
 
 /*
@@ -1395,26 +2382,44 @@ int8_t DABDUINO::setRTCclock(uint32_t year, uint32_t month, uint32_t day, uint32
  *  Get RTC ckock
  *  year: 2017=17,2018=18, month: 1..12, week: 0(sat)..6(fri), day: 1..31, hour: 0..23, minute: 0..59, second: 0..59 
  */
-int8_t DABDUINO::getRTCclock(uint32_t *year, uint32_t *month, uint32_t *week, uint32_t *day, uint32_t *hour, uint32_t *minute, uint32_t *second) {
+DABRtcTime DABDUINO::getRTCclock() {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
+  DABRtcTime result;
+  byte dabData[7];
   uint32_t dabDataSize;
   byte dabCommand[7] = { 0xFE, 0x02, 0x01, 0x00, 0x00, 0x00, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    if (dabDataSize) {
-      *second = (uint32_t)dabData[0];
-      *minute = (uint32_t)dabData[1];
-      *hour = (uint32_t)dabData[2];
-      *day = (uint32_t)dabData[3];
-      *week = (uint32_t)dabData[4];
-      *month = (uint32_t)dabData[5];
-      *year = (uint32_t)dabData[6];
-      return 1;
+  memset(&result, 0, sizeof(result));
+  result.status = exchange(dabCommand, dabData, &dabDataSize, sizeof(dabData));
+  if (result.status == DAB_STATUS_OK) {
+    if (dabDataSize < 7) {
+      result.status = DAB_STATUS_SHORT_FRAME;
+    } else {
+      result.second = dabData[0];
+      result.minute = dabData[1];
+      result.hour = dabData[2];
+      result.day = dabData[3];
+      result.week = dabData[4];
+      result.month = dabData[5];
+      result.year = dabData[6];
     }
-    return 0;
-  } else {
-    return 0;
   }
+  return result;
+}
+
+int8_t DABDUINO::getRTCclock(uint32_t *year, uint32_t *month, uint32_t *week, uint32_t *day, uint32_t *hour, uint32_t *minute, uint32_t *second) {
+
+  DABRtcTime result = getRTCclock();
+  if (result.status == DAB_STATUS_OK) {
+    *second = result.second;
+    *minute = result.minute;
+    *hour = result.hour;
+    *day = result.day;
+    *week = result.week;
+    *month = result.month;
+    *year = result.year;
+    return 1;
+  }
+  return 0;
 }
 
 /*
@@ -1451,46 +2456,92 @@ int8_t DABDUINO::RTCsyncDisable() {
  *  Get RTC sync clock status
  *  return data: 0=disable, 1=enable 
  */
+DABResult DABDUINO::getRTCsyncStatus() {
+
+  return getValue(0x02, 0x03, 1);
+}
+
 int8_t DABDUINO::getRTCsyncStatus(uint32_t *data) {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
-  uint32_t dabDataSize;
-  byte dabCommand[7] = { 0xFE, 0x02, 0x03, 0x00, 0x00, 0x00, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    if (dabDataSize) {
-      *data = (uint32_t)dabData[0];
-      return 1;
-    }
-    return 0;
-  } else {
-    return 0;
+  DABResult result = getRTCsyncStatus();
+  if (result.status == DAB_STATUS_OK) {
+    *data = result.value;
+    return 1;
   }
+  return 0;
 }
 
 /*
  *  Get RTC clock status
  *  return data: 0=unset, 1=set 
  */
+DABResult DABDUINO::getRTCclockStatus() {
+
+  return getValue(0x02, 0x04, 1);
+}
+
 int8_t DABDUINO::getRTCclockStatus(uint32_t *data) {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
-  uint32_t dabDataSize;
-  byte dabCommand[7] = { 0xFE, 0x02, 0x04, 0x00, 0x00, 0x00, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    if (dabDataSize) {
-      *data = (uint32_t)dabData[0];
-      return 1;
-    }
-    return 0;
-  } else {
-    return 0;
+  DABResult result = getRTCclockStatus();
+  if (result.status == DAB_STATUS_OK) {
+    *data = result.value;
+    return 1;
   }
+  return 0;
 }
 
 // ********************************************
 // ***** MOT (Multimedia Object Transfer) *****
 // ********************************************
 
+/*
+ *  Read one MSC data group from module SPI
+ *  Module sends data group size (2 bytes) followed by data group, size 0 or 0xFFFF=no data.
+ *  Bytes over dataSize are read and dropped.
+ *  return: data group size, 0=no data, -1=data group was bigger than dataSize
+ */
+int16_t DABDUINO::readMOTdata(byte data[], uint16_t dataSize) {
+
+  if (!spiStarted) {
+    // SPI is set up with first MOT read, sketches without media data keep SPI pins free
+    SPI.begin();
+    spiStarted = true;
+  }
+  SPI.beginTransaction(SPISettings(DAB_SPI_CLOCK, MSBFIRST, SPI_MODE0));
+  digitalWrite(spiCsPin, LOW);
+  uint16_t size = (SPI.transfer(0x00) << 8);
+  size += SPI.transfer(0x00);
+  if (size == 0xFFFF || size > DAB_MAX_MOT_DATA_LENGTH) {
+    size = 0;
+  }
+  for (uint16_t i = 0; i < size; i++) {
+    byte b = SPI.transfer(0x00);
+    if (i < dataSize) {
+      data[i] = b;
+    }
+  }
+  digitalWrite(spiCsPin, HIGH);
+  SPI.endTransaction();
+  if (size > dataSize) {
+    return -1;
+  }
+  return size;
+}
+
+/*
+ *  Read data group from module SPI and pass it to MOT decoder
+ *  buffer = buffer for one data group
+ *  return: 1=data group decoded, 0=no data
+ */
+int8_t DABDUINO::pollMOT(DABMOT *mot, byte buffer[], uint16_t bufferSize) {
+
+  int16_t size = readMOTdata(buffer, bufferSize);
+  if (size > 0) {
+    return mot->feedDataGroup(buffer, size);
+  }
+  return 0;
+}
+
 
 
 
@@ -1503,14 +2554,7 @@ int8_t DABDUINO::getRTCclockStatus(uint32_t *data) {
  */
 int8_t DABDUINO::eventNotificationEnable() {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
-  uint32_t dabDataSize;
-  byte dabCommand[9] = { 0xFE, 0x07, 0x00, 0x00, 0x00, 0x02, 0x00, 0x7F, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
-    return 1;
-  } else {
-    return 0;
-  }
+  return setEventMask(DAB_EVENT_ALL);
 }
 
 /*
@@ -1518,16 +2562,53 @@ int8_t DABDUINO::eventNotificationEnable() {
  */
 int8_t DABDUINO::eventNotificationDisable() {
 
-  byte dabData[DAB_MAX_DATA_LENGTH];
+  return setEventMask(0);
+}
+
+/*
+ *   Set event notification mask - module sends only selected events
+ *   mask = DAB_EVENT_SCAN_FINISHED | DAB_EVENT_PROGRAM_TEXT | DAB_EVENT_RECONFIGURATION | DAB_EVENT_SORT_CHANGE
+ *          | DAB_EVENT_RDS_GROUP | DAB_EVENT_FM_TEXT | DAB_EVENT_SCAN_FREQUENCY, DAB_EVENT_ALL, 0=none
+ */
+int8_t DABDUINO::setEventMask(uint16_t mask) {
+
+  byte dabData[1];
   uint32_t dabDataSize;
-  byte dabCommand[9] = { 0xFE, 0x07, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0xFD };
-  if (sendCommand(dabCommand, dabData, &dabDataSize)) {
+  mask &= DAB_EVENT_ALL;
+  byte dabCommand[9] = { 0xFE, 0x07, 0x00, 0x00, 0x00, 0x02, (byte)(mask >> 8), (byte)(mask & 0xFF), 0xFD };
+  if (exchange(dabCommand, dabData, &dabDataSize, sizeof(dabData)) == DAB_STATUS_OK) {
+    eventMask = mask;
+    eventMaskKnown = true;
     return 1;
   } else {
     return 0;
   }
 }
 
+/*
+ *   Get event notification mask set by setEventMask
+ *   return: mask, DAB_EVENT_ALL while not set yet (module mask unknown)
+ */
+uint16_t DABDUINO::getEventMask() {
+
+  return eventMask;
+}
+
+/*
+ *   Set handler of event type (1..7, see readEvent), called for every event
+ *   received (poll, readEvent and blocking commands waiting for answer)
+ *   instead of queueing it for readEvent/getEvent; NULL=queue event.
+ *   Handler must not send blocking commands, queueCommand is fine.
+ */
+void DABDUINO::setEventHandler(int8_t type, DABEventHandler handler, void *context) {
+
+  if (type < 1 || type > DAB_EVENT_TYPES) {
+    return;
+  }
+  eventHandlers[type - 1] = handler;
+  eventContexts[type - 1] = context;
+}
+
 
 
 
@@ -5,16 +5,210 @@
  * @license  BSD (see license.txt)
  */
 
+#ifndef DABDUINO_h
+#define DABDUINO_h
+
 #include "Arduino.h"
+#include "DABParser.h"
 
 #define DAB_MAX_TEXT_LENGTH 128
 #define DAB_MAX_DATA_LENGTH 2 * DAB_MAX_TEXT_LENGTH
+#define DAB_MAX_EVENT_DATA_LENGTH 16
+
+#define DAB_PIPELINE_DEPTH 4 // commands sent to module before first answer
+#define DAB_MAX_COMMAND_LENGTH 16
+#define DAB_QUEUE_LENGTH 4 // non-blocking commands waiting for module, per priority
+#define DAB_BACKGROUND_RATE 10 // background commands per second
+#define DAB_BACKGROUND_BURST 3 // background commands sent at once after idle time
+#define DAB_STARVATION_TIME 500 // command waiting longer is sent before higher priorities (ms)
+#define DAB_MAX_WAITERS 4 // handlers waiting for answer of identical queued command
+#define DAB_CACHE_ENTRIES 4 // cached getter answers
+#define DAB_CACHE_DATA_LENGTH 8
+#define DAB_CACHE_TIME 0 // default freshness of cached getter answer (ms), 0=no cache
+#define DAB_EVENT_QUEUE_LENGTH 4 // events received by poll()
+#define DAB_COMMAND_TIMEOUT 200 // timeout for answer from module (ms)
+#define DAB_TAP_CHUNK_LENGTH 32 // received bytes passed to tap at once
+
+#define DAB_SPI_CLOCK 4000000
+#define DAB_MAX_MOT_DATA_LENGTH 8192 // max MSC data group size
+
+#define DAB_TUNE_TIMEOUT 3000 // max time from play command to audio (ms)
+#define DAB_TUNE_POLL 50 // play status poll period while no event comes (ms)
+#define DAB_TUNE_SETTLE 500 // play status playing since play command for this time = tuned (ms)
+
+#define DAB_FM_PS_LENGTH 8
+#define DAB_FM_SEEK_TIMEOUT 10000 // max time of one seek over whole band (ms)
+#define DAB_FM_SEEK_SETTLE 300 // no scanning frequency event for this time = seek stopped (ms)
+#define DAB_FM_SIGNAL_SETTLE 100 // signal strength valid after FM tune (ms)
+#define DAB_FM_RDS_TIMEOUT 1500 // max time for capture of RDS PS name (ms)
 
 namespace constants
 {
 const int8_t DEMO = 0;
 }
 
+class DABTextCache;
+class DABMOT;
+
+struct DABFMStation
+{
+  uint32_t frequency; // kHz
+  uint8_t signalStrength; // 0..100
+  uint16_t piCode; // RDS PI code, 0=unknown
+  char psName[DAB_FM_PS_LENGTH + 1]; // RDS PS name
+};
+
+enum DABStatus : int8_t
+{
+  DAB_STATUS_OK = 0,
+  DAB_STATUS_TIMEOUT, // no answer from module
+  DAB_STATUS_NACK, // module refused command
+  DAB_STATUS_SHORT_FRAME // answer is shorter than expected
+};
+
+struct DABResult
+{
+  uint16_t value;
+  DABStatus status;
+};
+
+struct DABSignalInfo
+{
+  uint16_t bitErrorRate; // DAB
+  uint8_t strength; // DAB: 0..18, FM: 0..100
+  DABStatus status;
+};
+
+struct DABRdsGroup
+{
+  uint16_t block[4]; // A, B, C, D
+  uint16_t bler[4];
+  uint8_t state; // 1=new RDS data, 2=no new RDS data, 3=no RDS data
+  DABStatus status;
+};
+
+struct DABRtcTime
+{
+  uint8_t year; // 2017=17
+  uint8_t month; // 1..12
+  uint8_t week; // 0(sat)..6(fri)
+  uint8_t day; // 1..31
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t second;
+  DABStatus status;
+};
+
+// fields of DABPlaybackSnapshot, index to updated[]
+#define DAB_SNAPSHOT_PLAY_MODE 0
+#define DAB_SNAPSHOT_PLAY_STATUS 1
+#define DAB_SNAPSHOT_PLAY_INDEX 2
+#define DAB_SNAPSHOT_SIGNAL_STRENGTH 3
+#define DAB_SNAPSHOT_SIGNAL_QUALITY 4
+#define DAB_SNAPSHOT_STEREO_TYPE 5
+#define DAB_SNAPSHOT_SAMPLING_RATE 6
+#define DAB_SNAPSHOT_DATA_RATE 7
+#define DAB_SNAPSHOT_PROGRAM_TYPE 8
+#define DAB_SNAPSHOT_VOLUME 9
+#define DAB_SNAPSHOT_FIELDS 10
+
+struct DABPlaybackSnapshot
+{
+  uint8_t playMode; // 0=DAB, 1=FM, 2=BEEP, 255=Stream stop
+  uint8_t playStatus; // 0=playing, 1=searching, 2=tuning, 3=stop, 4=sorting change, 5=reconfiguration
+  uint32_t playIndex; // DAB station index or FM frequency
+  uint8_t signalStrength; // DAB: 0..18, FM: 0..100
+  uint16_t bitErrorRate; // DAB
+  uint8_t signalQuality; // DAB: 0..100
+  uint8_t stereoType; // DAB: 0=stereo, 1=join stereo, 2=dual channel, 3=single channel
+  uint8_t samplingRate; // 1=32kHz, 2=24kHz, 3=48kHz
+  uint16_t dataRate; // DAB: kbps
+  uint8_t programType; // DAB: 0..31
+  uint8_t volume; // 0..16
+  unsigned long updated[DAB_SNAPSHOT_FIELDS]; // millis() of last answer per field, 0=never
+};
+
+// event types (see readEvent)
+#define DAB_EVENT_TYPES 7
+// event mask flags (see setEventMask)
+#define DAB_EVENT_SCAN_FINISHED 0x0001 // 1=scan finish
+#define DAB_EVENT_PROGRAM_TEXT 0x0002 // 2=got new DAB program text
+#define DAB_EVENT_RECONFIGURATION 0x0004 // 3=DAB reconfiguration
+#define DAB_EVENT_SORT_CHANGE 0x0008 // 4=DAB channel list order change
+#define DAB_EVENT_RDS_GROUP 0x0010 // 5=RDS group
+#define DAB_EVENT_FM_TEXT 0x0020 // 6=got new FM radio text
+#define DAB_EVENT_SCAN_FREQUENCY 0x0040 // 7=scanning frequency /FM/
+#define DAB_EVENT_ALL 0x007F
+#define DAB_EVENT_FLAG(type) (1 << ((type) - 1))
+
+/*
+ * Handler of received event (see setEventHandler)
+ */
+typedef void (*DABEventHandler)(void *context, int8_t type, byte data[], uint8_t dataSize);
+
+/*
+ * Handler of pipelined command answer (see sendCommands)
+ */
+typedef void (*DABResponseHandler)(void *context, uint8_t index, int8_t status, byte dabData[], uint32_t dabDataSize);
+
+// command priorities
+#define DAB_PRIORITY_INTERACTIVE 0 // user actions
+#define DAB_PRIORITY_PLAYBACK 1 // keeps playback and display going
+#define DAB_PRIORITY_BACKGROUND 2 // polling, prefetch (rate limited)
+#define DAB_PRIORITIES 3
+
+struct DABRequest
+{
+  byte command[DAB_MAX_COMMAND_LENGTH];
+  DABResponseHandler handler;
+  void *context;
+  uint8_t index;
+  uint8_t id;
+  unsigned long queuedMillis;
+};
+
+struct DABWaiter
+{
+  DABResponseHandler handler;
+  void *context;
+  uint8_t index;
+  uint8_t requestId;
+  boolean used;
+};
+
+struct DABCacheEntry
+{
+  byte commandClass;
+  byte commandId;
+  uint8_t dataSize;
+  byte data[DAB_CACHE_DATA_LENGTH];
+  unsigned long time;
+};
+
+struct DABLinkStats
+{
+  uint32_t exchanges; // commands sent to module
+  uint32_t cacheHits; // answered from cache
+  uint32_t coalesced; // answered by identical queued command
+  uint32_t busyTime; // serial line waiting for answer (ms)
+};
+
+struct DABQueueStats
+{
+  uint32_t commands; // answered or timed out
+  uint32_t totalLatency; // from queueCommand to answer (ms)
+  uint16_t maxLatency; // ms
+  uint16_t dropped; // queue was full
+  uint16_t promoted; // sent before higher priority (starvation)
+};
+
+struct DABEvent
+{
+  int8_t type; // see readEvent
+  uint8_t dataSize;
+  byte data[DAB_MAX_EVENT_DATA_LENGTH];
+};
+
 class DABDUINO
 {
 public:
@@ -28,7 +222,28 @@ public:
 
   int8_t isEvent();
   int8_t readEvent();
+  int8_t getEventData(byte data[], uint32_t *dataSize);
+  int8_t getEvent(DABEvent *event);
   int8_t sendCommand(byte dabCommand[], byte dabData[], uint32_t *dabDataSize);
+  uint8_t sendCommands(byte *dabCommands[], uint8_t count, DABResponseHandler handler, void *context);
+  void writeCommand(byte dabCommand[]);
+  int8_t readResponse(byte dabData[], uint32_t *dabDataSize);
+  DABStatus exchange(byte dabCommand[], byte dabData[], uint32_t *dabDataSize, uint16_t dataLength);
+  void setTap(DABFrameTap tap, void *context);
+
+  // *************************
+  // ***** NON-BLOCKING ******
+  // *************************
+
+  void poll();
+  int8_t queueCommand(byte dabCommand[], DABResponseHandler handler, void *context, uint8_t index, uint8_t priority);
+  uint8_t getQueueLength();
+  const DABQueueStats *getQueueStats(uint8_t priority);
+  void resetQueueStats();
+  void setCacheTime(uint16_t cacheTime);
+  void clearCache();
+  const DABLinkStats *getLinkStats();
+  unsigned long getLinkIdleTime();
 
   // *************************
   // ***** SYSETEM ***********
@@ -47,24 +262,44 @@ public:
   int8_t playFM(uint32_t frequency);
   int8_t playBEEP();
   int8_t playSTOP();
+  int8_t tune(uint8_t mode, uint32_t programIndex);
+  unsigned long getTuneTime();
+  uint8_t getPlayingMode();
+  uint32_t getPlayingIndex();
+  void setMute(boolean mute);
   int8_t searchDAB(uint32_t band);
   int8_t searchFM(uint32_t seekDirection);
+  uint8_t scanFM(DABFMStation stations[], uint8_t stationsSize, boolean withRDS);
+  int8_t getStationRDS(DABFMStation *station);
   int8_t playStatus(uint32_t *data);
+  DABResult playStatus();
   int8_t playMode(uint32_t *data);
+  DABResult playMode();
   int8_t getPlayIndex(uint32_t *data);
+  int8_t getPlaybackSnapshot(DABPlaybackSnapshot *snapshot);
   int8_t getSignalStrength(uint32_t *signalStrength, uint32_t *bitErrorRate);
+  DABSignalInfo getSignalStrength();
   int8_t setStereoMode(boolean stereo);
   int8_t getStereoMode(uint32_t *data);
+  DABResult getStereoMode();
   int8_t getStereoType(uint32_t *data);
+  DABResult getStereoType();
   int8_t setVolume(uint32_t volumeLevel);
   int8_t getVolume(uint32_t *data);
+  DABResult getVolume();
   int8_t getProgramType(uint32_t *data);
+  DABResult getProgramType();
   int8_t getProgramShortName(uint32_t programIndex, char text[]);
   int8_t getProgramLongName(uint32_t programIndex, char text[]);
   int8_t getProgramText(char text[]);
+  int8_t decodeProgramText(byte dabData[], uint32_t dabDataSize, char text[]);
+  void setTextCache(DABTextCache *cache);
   int8_t getSamplingRate(uint32_t *data);
+  DABResult getSamplingRate();
   int8_t getDataRate(uint32_t *data);
+  DABResult getDataRate();
   int8_t getSignalQuality(uint32_t *data);
+  DABResult getSignalQuality();
   int8_t getFrequency(uint32_t programIndex, uint32_t *data);
   int8_t getEnsembleShortName(uint32_t programIndex, char text[]);
   int8_t getEnsembleLongName(uint32_t programIndex, char text[]);
@@ -80,6 +315,7 @@ public:
   int8_t getProgramSorter(uint32_t *data);
   int8_t setProgramSorter(uint32_t sortMethod);
   int8_t getDRC(uint32_t *data);
+  DABResult getDRC();
   int8_t setDRC(uint32_t setDRC);
   int8_t prunePrograms(uint32_t *prunedTotalPrograms, uint32_t *prunedProgramIndex);
   int8_t getECC(uint32_t *ECC, uint32_t *countryId);
@@ -87,6 +323,8 @@ public:
   int8_t setFMstereoThdLevel(uint32_t RSSItresholdLevel);
   int8_t getFMstereoThdLevel(uint32_t *data);
   int8_t getRDSrawData(uint32_t *RDSblockA, uint32_t *RDSblockB, uint32_t *RDSblockC, uint32_t *RDSblockD, uint32_t *BlerA, uint32_t *BlerB, uint32_t *BlerC, uint32_t *BlerD);
+  DABRdsGroup getRDSrawData();
+  static void decodeRDSrawData(byte dabData[], uint32_t dabDataSize, DABRdsGroup *group);
   int8_t setFMseekTreshold(uint32_t RSSItreshold);
   int8_t getFMseekTreshold(uint32_t *data);
   int8_t setFMstereoTreshold(uint32_t RSSIstereoTreshold);
@@ -99,16 +337,20 @@ public:
 
   int8_t setRTCclock(uint32_t year, uint32_t month, uint32_t day, uint32_t hour, uint32_t minute, uint32_t second);
   int8_t getRTCclock(uint32_t *year, uint32_t *month, uint32_t *week, uint32_t *day, uint32_t *hour, uint32_t *minute, uint32_t *second);
+  DABRtcTime getRTCclock();
   int8_t RTCsyncEnable();
   int8_t RTCsyncDisable();
   int8_t getRTCsyncStatus(uint32_t *data);
+  DABResult getRTCsyncStatus();
   int8_t getRTCclockStatus(uint32_t *data);
+  DABResult getRTCclockStatus();
 
   // ********************************************
   // ***** MOT (Multimedia Object Transfer) *****
   // ********************************************
 
-
+  int16_t readMOTdata(byte data[], uint16_t dataSize);
+  int8_t pollMOT(DABMOT *mot, byte buffer[], uint16_t bufferSize);
 
   // *************************
   // ***** NOTIFY ************
@@ -116,13 +358,75 @@ public:
 
   int8_t eventNotificationEnable();
   int8_t eventNotificationDisable();
+  int8_t setEventMask(uint16_t mask);
+  uint16_t getEventMask();
+  void setEventHandler(int8_t type, DABEventHandler handler, void *context);
 
 
 
 private:
+  DABStatus receive(byte dabCommand[], byte dabData[], uint32_t *dabDataSize, uint16_t dataLength);
+  boolean receiveFrame();
+  int readSerial();
+  void drainSerial();
+  void flushTap();
+  DABResult getValue(byte commandClass, byte commandId, uint8_t valueSize);
+  void waitIdle();
+  int8_t selectQueue();
+  int8_t coalesce(byte dabCommand[], DABResponseHandler handler, void *context, uint8_t index, uint8_t priority);
+  boolean isCacheable(byte dabCommand[]);
+  int8_t cacheLookup(byte dabCommand[], byte dabData[], uint32_t *dabDataSize, uint16_t dataLength);
+  void cacheStore(byte dabCommand[], byte dabData[], uint32_t dabDataSize);
+  void frameReceived();
+  boolean isAnswerTo(byte dabCommand[]);
+  void requestFinished(int8_t status, byte dabData[], uint32_t dabDataSize);
+  void pushEvent(int8_t type, byte data[], uint32_t dataSize);
+
   HardwareSerial *_Serial;
   int8_t resetPin;
   int8_t dacMutePin;
   int8_t spiCsPin;
+  boolean spiStarted;
+  byte eventData[DAB_MAX_EVENT_DATA_LENGTH];
+  uint32_t eventDataSize;
+  unsigned long tuneTime;
+  uint8_t playingMode; // set by play commands, see getPlayingMode
+  uint32_t playingIndex;
+
+  // non-blocking engine
+  DABRequest queue[DAB_PRIORITIES][DAB_QUEUE_LENGTH];
+  uint8_t queueHead[DAB_PRIORITIES];
+  uint8_t queueCount[DAB_PRIORITIES];
+  DABQueueStats queueStats[DAB_PRIORITIES];
+  DABRequest current; // command waiting for answer
+  uint8_t currentPriority;
+  uint8_t requestId;
+  DABWaiter waiters[DAB_MAX_WAITERS];
+  DABCacheEntry cache[DAB_CACHE_ENTRIES];
+  uint16_t cacheTime;
+  DABLinkStats linkStats;
+  uint16_t backgroundTokens; // 1000 = one command
+  unsigned long tokensMillis;
+  boolean inFlight;
+  boolean holdQueue; // blocking command in progress
+  unsigned long sentMillis;
+  unsigned long idleSince;
+  DABParser rx;
+  DABFrameTap tap;
+  void *tapContext;
+  byte tapChunk[DAB_TAP_CHUNK_LENGTH]; // received bytes not passed to tap yet
+  uint8_t tapChunkLength;
+  DABEvent events[DAB_EVENT_QUEUE_LENGTH];
+  uint16_t eventMask;
+  boolean eventMaskKnown; // set by setEventMask, module default unknown
+  DABEventHandler eventHandlers[DAB_EVENT_TYPES]; // dispatch table by event type - 1
+  void *eventContexts[DAB_EVENT_TYPES];
+  uint8_t eventsHead;
+  uint8_t eventsCount;
+
+  uint32_t textHash;
+  uint32_t textServiceKey;
+  DABTextCache *textCache;
 };
 
+#endif
@@ -0,0 +1,333 @@
+/*
+ * DABEPG.cpp - EPG/SPI (Service and Programme Information) decoder for DABDUINO library.
+ * Binary EPG: ETSI TS 102 371
+ * @license  BSD (see license.txt)
+ */
+
+#include "DABEPG.h"
+
+// parser states
+#define DAB_EPG_TAG 0
+#define DAB_EPG_LENGTH 1
+#define DAB_EPG_LENGTH_EXT 2
+#define DAB_EPG_VALUE 3
+#define DAB_EPG_STOP 4
+
+// elements and attributes
+#define DAB_EPG_CDATA 0x01
+#define DAB_EPG_EPG 0x02
+#define DAB_EPG_SHORT_NAME 0x10
+#define DAB_EPG_MEDIUM_NAME 0x11
+#define DAB_EPG_LONG_NAME 0x12
+#define DAB_EPG_LOCATION 0x19
+#define DAB_EPG_PROGRAMME 0x1C
+#define DAB_EPG_SCHEDULE 0x21
+#define DAB_EPG_SCOPE 0x24
+#define DAB_EPG_SERVICE_SCOPE 0x25
+#define DAB_EPG_TIME 0x2C
+#define DAB_EPG_ATTR_TIME 0x80
+#define DAB_EPG_ATTR_DURATION 0x81
+#define DAB_EPG_ATTR_ID 0x80
+
+DABEPG::DABEPG() {
+
+  clear();
+  begin(0);
+}
+
+/*
+ * Clear programme store
+ */
+void DABEPG::clear() {
+
+  servicesCount = 0;
+  nextReplace = 0;
+}
+
+/*
+ * Start decoding of new EPG object
+ * serviceId = service of schedule, 0=take service from schedule scope
+ */
+void DABEPG::begin(uint32_t serviceId) {
+
+  state = DAB_EPG_TAG;
+  position = 0;
+  depth = 0;
+  this->serviceId = serviceId;
+  fixedServiceId = (serviceId != 0);
+  memset(&programme, 0, sizeof(programme));
+}
+
+/*
+ * Decode next part of EPG object, object is never stored whole
+ */
+void DABEPG::feed(const byte data[], uint32_t dataSize) {
+
+  for (uint32_t i = 0; i < dataSize && state != DAB_EPG_STOP; i++) {
+    byte b = data[i];
+    position++;
+    switch (state) {
+    case DAB_EPG_TAG:
+      tag = b;
+      state = DAB_EPG_LENGTH;
+      break;
+    case DAB_EPG_LENGTH:
+      if (b == 0xFE || b == 0xFF) {
+        lengthBytes = (b == 0xFE) ? 2 : 3;
+        length = 0;
+        state = DAB_EPG_LENGTH_EXT;
+        break;
+      }
+      length = b;
+      lengthBytes = 0;
+      // fall through
+    case DAB_EPG_LENGTH_EXT:
+      if (lengthBytes) {
+        length = (length << 8) + b;
+        if (--lengthBytes) break;
+      }
+      if (depth == 0 && position <= 4 && tag != DAB_EPG_EPG) {
+        state = DAB_EPG_STOP; // not EPG object
+      } else if (isContainer(tag) && length && depth < DAB_EPG_MAX_DEPTH) {
+        stackTag[depth] = tag;
+        stackEnd[depth] = position + length;
+        depth++;
+        elementStart(tag);
+        state = DAB_EPG_TAG;
+      } else if (length == 0) {
+        value(tag, valueBuffer, 0);
+        state = DAB_EPG_TAG;
+      } else {
+        valueSize = 0;
+        state = DAB_EPG_VALUE;
+      }
+      break;
+    case DAB_EPG_VALUE:
+      if (valueSize < DAB_EPG_MAX_VALUE_LENGTH) {
+        valueBuffer[valueSize++] = b;
+      }
+      if (--length == 0) {
+        value(tag, valueBuffer, valueSize);
+        state = DAB_EPG_TAG;
+      }
+      break;
+    }
+    while (depth && stackEnd[depth - 1] == position) {
+      depth--;
+      elementEnd(stackTag[depth]);
+    }
+  }
+}
+
+/*
+ * End of EPG object
+ */
+void DABEPG::end() {
+
+  state = DAB_EPG_STOP;
+}
+
+/*
+ * Sink for DABMOT - decode EPG objects while they are received, other
+ * objects of carousel (logos) are skipped
+ * context = DABEPG
+ */
+void DABEPG::motSink(void *context, const DABMOTObject *object, const byte data[], uint16_t dataSize) {
+
+  DABEPG *epg = (DABEPG *)context;
+  if (object->contentType != DAB_MOT_TYPE_EPG) return;
+  if (dataSize == 0) {
+    epg->end();
+    return;
+  }
+  if (object->received == 0) {
+    epg->begin(0);
+  }
+  epg->feed(data, dataSize);
+}
+
+/*
+ * Get now and next programme of service
+ * now = UTC, seconds since 1.1.1970
+ * return: 1=some programme found, 0=no programme
+ */
+int8_t DABEPG::getNowNext(uint32_t serviceId, uint32_t now, const DABEPGProgramme **nowProgramme, const DABEPGProgramme **nextProgramme) {
+
+  *nowProgramme = NULL;
+  *nextProgramme = NULL;
+  DABEPGService *service = findService(serviceId, false);
+  if (!service || !service->count) return 0;
+
+  // cursor only moves forward with time
+  if (service->current >= service->count || service->programmes[service->current].start > now) {
+    service->current = 0;
+  }
+  while (service->current + 1 < service->count && service->programmes[service->current + 1].start <= now) {
+    service->current++;
+  }
+  DABEPGProgramme *programme = &service->programmes[service->current];
+  if (programme->start <= now) {
+    if (now < programme->start + programme->duration) {
+      *nowProgramme = programme;
+    }
+    if (service->current + 1 < service->count) {
+      *nextProgramme = programme + 1;
+    }
+  } else {
+    *nextProgramme = programme;
+  }
+  return (*nowProgramme || *nextProgramme) ? 1 : 0;
+}
+
+/*
+ * Get all stored programmes of service
+ */
+const DABEPGService *DABEPG::getService(uint32_t serviceId) {
+
+  return findService(serviceId, false);
+}
+
+/*
+ * Decode EPG timePoint to UTC seconds since 1.1.1970
+ * rfu(1) MJD(17) rfu(1) LTO(1) UTC flag(1) hours(5) minutes(6) [seconds(6) milliseconds(10)]
+ */
+uint32_t DABEPG::decodeTime(const byte data[], uint8_t dataSize) {
+
+  if (dataSize < 4) return 0;
+  uint32_t v = ((uint32_t)data[0] << 24) + ((uint32_t)data[1] << 16) + ((uint32_t)data[2] << 8) + data[3];
+  uint32_t mjd = (v >> 14) & 0x1FFFF;
+  if (mjd < 40587) return 0;
+  uint32_t time = (mjd - 40587) * 86400UL + ((v >> 6) & 0x1F) * 3600UL + (v & 0x3F) * 60UL;
+  if (((v >> 11) & 0x01) && dataSize >= 6) {
+    time += data[4] >> 2;
+  }
+  return time;
+}
+
+boolean DABEPG::isContainer(byte tag) {
+
+  switch (tag) {
+  case DAB_EPG_EPG:
+  case DAB_EPG_SCHEDULE:
+  case DAB_EPG_SCOPE:
+  case DAB_EPG_SERVICE_SCOPE:
+  case DAB_EPG_PROGRAMME:
+  case DAB_EPG_LOCATION:
+  case DAB_EPG_TIME:
+  case DAB_EPG_SHORT_NAME:
+  case DAB_EPG_MEDIUM_NAME:
+  case DAB_EPG_LONG_NAME:
+    return true;
+  }
+  return false;
+}
+
+void DABEPG::elementStart(byte tag) {
+
+  if (tag == DAB_EPG_PROGRAMME) {
+    memset(&programme, 0, sizeof(programme));
+    nameRank = 0;
+  }
+}
+
+void DABEPG::elementEnd(byte tag) {
+
+  if (tag == DAB_EPG_PROGRAMME && programme.start) {
+    store();
+  }
+}
+
+void DABEPG::value(byte tag, const byte data[], uint8_t dataSize) {
+
+  if (!depth) return;
+  byte parent = stackTag[depth - 1];
+  byte grandParent = (depth > 1) ? stackTag[depth - 2] : 0;
+
+  // programme location time
+  if (parent == DAB_EPG_TIME && grandParent == DAB_EPG_LOCATION) {
+    if (tag == DAB_EPG_ATTR_TIME && !programme.start) {
+      programme.start = decodeTime(data, dataSize);
+    } else if (tag == DAB_EPG_ATTR_DURATION && dataSize >= 2) {
+      programme.duration = (data[0] << 8) + data[1];
+    }
+    return;
+  }
+
+  // programme name, mediumName is preferred
+  if (tag == DAB_EPG_CDATA && grandParent == DAB_EPG_PROGRAMME) {
+    byte rank = (parent == DAB_EPG_MEDIUM_NAME) ? 3 : (parent == DAB_EPG_LONG_NAME) ? 2 : 1;
+    if (rank > nameRank) {
+      nameRank = rank;
+      uint8_t j = 0;
+      for (uint8_t i = 0; i < dataSize && j < DAB_EPG_NAME_LENGTH; i++) {
+        if (data[i] >= 0x20) programme.name[j++] = data[i]; // skip tokens
+      }
+      programme.name[j] = 0x00;
+    }
+    return;
+  }
+
+  // schedule scope contentId: flags(1) [ECC(1) EId(2)] SId(2 or 4)
+  if (tag == DAB_EPG_ATTR_ID && parent == DAB_EPG_SERVICE_SCOPE && !fixedServiceId && dataSize >= 3) {
+    uint8_t index = (data[0] & 0x40) ? 4 : 1;
+    if (data[0] & 0x10) {
+      if (index + 4 <= dataSize) {
+        serviceId = ((uint32_t)data[index] << 24) + ((uint32_t)data[index + 1] << 16) + ((uint32_t)data[index + 2] << 8) + data[index + 3];
+      }
+    } else if (index + 2 <= dataSize) {
+      serviceId = (data[index] << 8) + data[index + 1];
+    }
+  }
+}
+
+DABEPGService *DABEPG::findService(uint32_t serviceId, boolean add) {
+
+  for (uint8_t i = 0; i < servicesCount; i++) {
+    if (services[i].serviceId == serviceId) {
+      return &services[i];
+    }
+  }
+  if (!add) return NULL;
+  DABEPGService *service;
+  if (servicesCount < DAB_EPG_SERVICES) {
+    service = &services[servicesCount++];
+  } else {
+    service = &services[nextReplace];
+    nextReplace = (nextReplace + 1) % DAB_EPG_SERVICES;
+  }
+  service->serviceId = serviceId;
+  service->count = 0;
+  service->current = 0;
+  return service;
+}
+
+/*
+ * Store decoded programme sorted by start, oldest programme is dropped when store is full
+ */
+void DABEPG::store() {
+
+  if (!serviceId) return;
+  DABEPGService *service = findService(serviceId, true);
+  uint8_t i = 0;
+  while (i < service->count && service->programmes[i].start < programme.start) {
+    i++;
+  }
+  if (i < service->count && service->programmes[i].start == programme.start) {
+    service->programmes[i] = programme; // update
+    return;
+  }
+  if (service->count == DAB_EPG_PROGRAMMES) {
+    if (i == 0) return; // older than all stored
+    for (uint8_t j = 1; j < i; j++) {
+      service->programmes[j - 1] = service->programmes[j];
+    }
+    i--;
+  } else {
+    for (uint8_t j = service->count; j > i; j--) {
+      service->programmes[j] = service->programmes[j - 1];
+    }
+    service->count++;
+  }
+  service->programmes[i] = programme;
+  service->current = 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * DABEPG.h - EPG/SPI (Service and Programme Information) decoder for DABDUINO library.
+ * Streaming decoder of binary EPG schedule (ETSI TS 102 371) into compact
+ * programme store keyed by service id (see DABDUINO::getProgramInfo).
+ * Has no hardware dependency, like DABMOT.
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef DABEPG_h
+#define DABEPG_h
+
+#include "DABMOT.h"
+
+#ifndef DAB_EPG_SERVICES
+#define DAB_EPG_SERVICES 4 // number of services in store
+#endif
+#ifndef DAB_EPG_PROGRAMMES
+#define DAB_EPG_PROGRAMMES 16 // number of programmes per service
+#endif
+#define DAB_EPG_NAME_LENGTH 16 // mediumName
+#define DAB_EPG_MAX_DEPTH 8
+#define DAB_EPG_MAX_VALUE_LENGTH DAB_EPG_NAME_LENGTH
+
+struct DABEPGProgramme
+{
+  uint32_t start; // UTC, seconds since 1.1.1970
+  uint16_t duration; // seconds
+  char name[DAB_EPG_NAME_LENGTH + 1];
+};
+
+struct DABEPGService
+{
+  uint32_t serviceId;
+  uint8_t count;
+  uint8_t current; // now playing programme cursor
+  DABEPGProgramme programmes[DAB_EPG_PROGRAMMES]; // sorted by start
+};
+
+class DABEPG
+{
+public:
+
+  DABEPG();
+
+  void clear();
+  void begin(uint32_t serviceId);
+  void feed(const byte data[], uint32_t dataSize);
+  void end();
+
+  static void motSink(void *context, const DABMOTObject *object, const byte data[], uint16_t dataSize);
+
+  int8_t getNowNext(uint32_t serviceId, uint32_t now, const DABEPGProgramme **nowProgramme, const DABEPGProgramme **nextProgramme);
+  const DABEPGService *getService(uint32_t serviceId);
+
+  static uint32_t decodeTime(const byte data[], uint8_t dataSize);
+
+private:
+  void elementStart(byte tag);
+  void elementEnd(byte tag);
+  void value(byte tag, const byte data[], uint8_t dataSize);
+  boolean isContainer(byte tag);
+  DABEPGService *findService(uint32_t serviceId, boolean add);
+  void store();
+
+  // parser state
+  byte state;
+  byte tag;
+  byte lengthBytes;
+  uint32_t length;
+  uint32_t position;
+  uint32_t stackEnd[DAB_EPG_MAX_DEPTH];
+  byte stackTag[DAB_EPG_MAX_DEPTH];
+  byte depth;
+  byte valueBuffer[DAB_EPG_MAX_VALUE_LENGTH];
+  uint8_t valueSize;
+
+  // decoded programme
+  uint32_t serviceId;
+  boolean fixedServiceId;
+  DABEPGProgramme programme;
+  byte nameRank;
+
+  DABEPGService services[DAB_EPG_SERVICES];
+  uint8_t servicesCount;
+  uint8_t nextReplace;
+};
+
+#endif
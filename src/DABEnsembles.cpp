@@ -0,0 +1,197 @@
+/*
+ * DABEnsembles.cpp - Ensemble map for DABDUINO library.
+ * @license  BSD (see license.txt)
+ */
+
+#include "DABEnsembles.h"
+
+DABEnsembles::DABEnsembles(DABDUINO& dab, DABStations *stations) {
+
+  this->dab = &dab;
+  this->stations = stations;
+  count = 0;
+  memset(programEnsemble, 0xFF, sizeof(programEnsemble));
+  resetSwitchStats();
+}
+
+/*
+ * Build map from stations with known frequency (load stations with
+ * DAB_STATION_FREQUENCY before), call again after stations change
+ * return: number of ensembles
+ */
+uint8_t DABEnsembles::build() {
+
+  uint8_t programCount = 0;
+  count = 0;
+  memset(programEnsemble, 0xFF, sizeof(programEnsemble));
+  // counting sort by frequency index, program order inside ensemble is kept
+  for (uint8_t frequencyIndex = 0; frequencyIndex < DAB_CHANNELS && count < DAB_MAX_ENSEMBLES; frequencyIndex++) {
+    DABEnsemble *ensemble = &ensembles[count];
+    ensemble->first = programCount;
+    ensemble->count = 0;
+    for (uint16_t program = 0; program < stations->getCount(); program++) {
+      DABStation *station = stations->getStation(program);
+      if (!(station->valid & DAB_STATION_FREQUENCY) || station->frequencyIndex != frequencyIndex) {
+        continue;
+      }
+      if (!ensemble->count) {
+        ensemble->frequencyIndex = frequencyIndex;
+        ensemble->ensembleId = (station->valid & DAB_STATION_INFO) ? station->ensembleId : 0;
+      }
+      programs[programCount++] = program;
+      programEnsemble[program] = count;
+      ensemble->count++;
+    }
+    if (ensemble->count) {
+      count++;
+    }
+  }
+  return count;
+}
+
+uint8_t DABEnsembles::getCount() {
+
+  return count;
+}
+
+const DABEnsemble *DABEnsembles::getEnsemble(uint8_t ensemble) {
+
+  return (ensemble < count) ? &ensembles[ensemble] : NULL;
+}
+
+/*
+ * Find ensemble on frequency index
+ * return: ensemble, -1=none
+ */
+int8_t DABEnsembles::findFrequency(uint8_t frequencyIndex) {
+
+  for (uint8_t i = 0; i < count; i++) {
+    if (ensembles[i].frequencyIndex == frequencyIndex) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*
+ * Find ensemble of program
+ * return: ensemble, -1=program not in map
+ */
+int8_t DABEnsembles::findProgram(uint32_t programIndex) {
+
+  if (programIndex >= DAB_MAX_STATIONS || programEnsemble[programIndex] == 0xFF) {
+    return -1;
+  }
+  return programEnsemble[programIndex];
+}
+
+/*
+ * Get program indexes of services sharing ensemble
+ * return: program indexes, NULL=no such ensemble
+ */
+const uint8_t *DABEnsembles::getPrograms(uint8_t ensemble, uint8_t *count) {
+
+  if (ensemble >= this->count) {
+    *count = 0;
+    return NULL;
+  }
+  *count = ensembles[ensemble].count;
+  return &programs[ensembles[ensemble].first];
+}
+
+/*
+ * Check if program is in multiplex of playing program (switch needs no retune)
+ */
+boolean DABEnsembles::isInMux(uint32_t programIndex) {
+
+  int16_t playing = getCurrent();
+  return playing >= 0 && findProgram(programIndex) >= 0 && findProgram(programIndex) == findProgram(playing);
+}
+
+/*
+ * Get next service in same multiplex, wraps around
+ * direction = 1=next, -1=previous
+ * return: program index, -1=program not in map
+ */
+int16_t DABEnsembles::nextInMux(uint32_t programIndex, int8_t direction) {
+
+  int8_t ensemble = findProgram(programIndex);
+  if (ensemble < 0) {
+    return -1;
+  }
+  uint8_t services;
+  const uint8_t *list = getPrograms(ensemble, &services);
+  for (uint8_t i = 0; i < services; i++) {
+    if (list[i] == programIndex) {
+      return list[(i + services + direction) % services];
+    }
+  }
+  return -1;
+}
+
+/*
+ * Play DAB program - in multiplex of playing program only audio decoder
+ * switches, so DAC is not muted and play status is polled fast; other
+ * programs are tuned by DABDUINO::tune. Time to audio is added to switch stats.
+ * return: 1=playing, 0=error or timeout
+ */
+int8_t DABEnsembles::play(uint32_t programIndex) {
+
+  uint8_t kind = isInMux(programIndex) ? DAB_SWITCH_IN_MUX : DAB_SWITCH_RETUNE;
+  unsigned long startMillis = millis();
+  int8_t playing = 0;
+  if (kind == DAB_SWITCH_RETUNE) {
+    playing = dab->tune(0, programIndex);
+  } else if (dab->playDAB(programIndex)) {
+    unsigned long pollMillis = millis();
+    while (!playing && millis() - startMillis < DAB_TUNE_TIMEOUT) {
+      if (millis() - pollMillis >= DAB_SWITCH_POLL) {
+        pollMillis = millis();
+        dab->clearCache(); // status from module, not cached answer of poll before
+        DABResult status = dab->playStatus();
+        playing = (status.status == DAB_STATUS_OK && status.value == 0);
+      }
+    }
+  }
+  uint16_t time = millis() - startMillis;
+  DABSwitchStats *stats = &switchStats[kind];
+  if (playing) {
+    stats->switches++;
+    stats->totalTime += time;
+    stats->lastTime = time;
+    if (time > stats->maxTime) {
+      stats->maxTime = time;
+    }
+  } else {
+    stats->failed++;
+  }
+  return playing;
+}
+
+/*
+ * Get switch time statistics
+ * kind = DAB_SWITCH_IN_MUX, DAB_SWITCH_RETUNE
+ */
+const DABSwitchStats *DABEnsembles::getSwitchStats(uint8_t kind) {
+
+  return &switchStats[kind ? DAB_SWITCH_RETUNE : DAB_SWITCH_IN_MUX];
+}
+
+void DABEnsembles::resetSwitchStats() {
+
+  memset(switchStats, 0, sizeof(switchStats));
+}
+
+/*
+ * Get playing program index tracked by DABDUINO (see getPlayingMode), no
+ * module round trip - application may have tuned other program or FM by
+ * DABDUINO::tune/playDAB/playFM since play()
+ * return: program index, -1=not playing DAB or unknown
+ */
+int16_t DABEnsembles::getCurrent() {
+
+  if (dab->getPlayingMode() == 0) {
+    return dab->getPlayingIndex();
+  }
+  return -1;
+}
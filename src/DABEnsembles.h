@@ -0,0 +1,71 @@
+/*
+ * DABEnsembles.h - Ensemble map for DABDUINO library.
+ * Groups cached stations (see DABStations) by frequency index, so services
+ * sharing a multiplex are found without module round trip, and switches
+ * service inside multiplex without retune wait.
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef DABEnsembles_h
+#define DABEnsembles_h
+
+#include "DABDUINO.h"
+#include "DABStations.h"
+#include "DABChannels.h"
+
+#define DAB_MAX_ENSEMBLES 16
+#define DAB_SWITCH_POLL 10 // play status poll period of in-multiplex switch (ms)
+
+// switch kinds (see getSwitchStats)
+#define DAB_SWITCH_IN_MUX 0
+#define DAB_SWITCH_RETUNE 1
+
+struct DABEnsemble
+{
+  uint8_t frequencyIndex; // see DABChannels
+  uint16_t ensembleId; // of first service, 0=unknown
+  uint8_t first; // position of first service in program list
+  uint8_t count; // services in ensemble
+};
+
+struct DABSwitchStats
+{
+  uint16_t switches;
+  uint16_t failed;
+  uint32_t totalTime; // from play command to audio (ms)
+  uint16_t maxTime; // ms
+  uint16_t lastTime; // ms
+};
+
+class DABEnsembles
+{
+public:
+
+  DABEnsembles(DABDUINO& dab, DABStations *stations);
+
+  uint8_t build();
+  uint8_t getCount();
+  const DABEnsemble *getEnsemble(uint8_t ensemble);
+  int8_t findFrequency(uint8_t frequencyIndex);
+  int8_t findProgram(uint32_t programIndex);
+  const uint8_t *getPrograms(uint8_t ensemble, uint8_t *count);
+
+  boolean isInMux(uint32_t programIndex);
+  int16_t nextInMux(uint32_t programIndex, int8_t direction);
+  int8_t play(uint32_t programIndex);
+  const DABSwitchStats *getSwitchStats(uint8_t kind);
+  void resetSwitchStats();
+
+private:
+  int16_t getCurrent();
+
+  DABDUINO *dab;
+  DABStations *stations;
+  DABEnsemble ensembles[DAB_MAX_ENSEMBLES]; // sorted by frequency index
+  uint8_t count;
+  uint8_t programs[DAB_MAX_STATIONS]; // program indexes grouped by ensemble
+  uint8_t programEnsemble[DAB_MAX_STATIONS]; // ensemble of program index, 0xFF=none
+  DABSwitchStats switchStats[2];
+};
+
+#endif
@@ -0,0 +1,151 @@
+/*
+ * DABLog.cpp - Serial link log for DABDUINO library.
+ * @license  BSD (see license.txt)
+ */
+
+#include "DABLog.h"
+
+DABLog::DABLog() {
+
+  writer = NULL;
+  writerContext = NULL;
+  records = 0;
+  clear();
+}
+
+/*
+ * Set writer of records (SD card, host file), NULL=RAM ring buffer
+ */
+void DABLog::setWriter(DABLogWriter writer, void *context) {
+
+  this->writer = writer;
+  writerContext = context;
+}
+
+/*
+ * Log one sent frame or received bytes
+ */
+void DABLog::record(uint8_t direction, uint32_t micros, const byte frame[], uint16_t frameSize) {
+
+  byte header[DAB_LOG_RECORD_HEADER_LENGTH] = {
+    direction,
+    (byte)micros, (byte)(micros >> 8), (byte)(micros >> 16), (byte)(micros >> 24),
+    (byte)frameSize, (byte)(frameSize >> 8)
+  };
+  records++;
+  if (writer) {
+    writer(writerContext, header, DAB_LOG_RECORD_HEADER_LENGTH);
+    writer(writerContext, frame, frameSize);
+    return;
+  }
+  uint16_t size = DAB_LOG_RECORD_HEADER_LENGTH + frameSize;
+  if (size > DAB_LOG_BUFFER_SIZE) {
+    dropped++;
+    return;
+  }
+  while (DAB_LOG_BUFFER_SIZE - length < size) {
+    // drop oldest record
+    uint16_t oldest = recordLength(head);
+    head = (head + oldest) % DAB_LOG_BUFFER_SIZE;
+    length -= oldest;
+    dropped++;
+  }
+  put(header, DAB_LOG_RECORD_HEADER_LENGTH);
+  put(frame, frameSize);
+}
+
+/*
+ * Tap for DABDUINO::setTap, context = DABLog
+ */
+void DABLog::tap(void *context, uint8_t direction, uint32_t micros, const byte frame[], uint16_t frameSize) {
+
+  ((DABLog *)context)->record(direction, micros, frame, frameSize);
+}
+
+/*
+ * Get number of bytes in RAM ring buffer
+ */
+uint16_t DABLog::getLength() {
+
+  return length;
+}
+
+/*
+ * Take oldest whole records from RAM ring buffer (e.g. to dump them over Serial)
+ * return: number of bytes copied to data
+ */
+uint16_t DABLog::read(byte data[], uint16_t dataSize) {
+
+  uint16_t copied = 0;
+  while (length) {
+    uint16_t size = recordLength(head);
+    if (copied + size > dataSize) {
+      break;
+    }
+    for (uint16_t i = 0; i < size; i++) {
+      data[copied++] = buffer[(head + i) % DAB_LOG_BUFFER_SIZE];
+    }
+    head = (head + size) % DAB_LOG_BUFFER_SIZE;
+    length -= size;
+  }
+  return copied;
+}
+
+/*
+ * Empty RAM ring buffer
+ */
+void DABLog::clear() {
+
+  head = 0;
+  length = 0;
+  dropped = 0;
+}
+
+/*
+ * Get number of logged records
+ */
+uint32_t DABLog::getRecords() {
+
+  return records;
+}
+
+/*
+ * Get number of records dropped from full RAM ring buffer
+ */
+uint32_t DABLog::getDropped() {
+
+  return dropped;
+}
+
+/*
+ * Parse record at start of data
+ * return: record length, 0=data does not hold whole record
+ */
+uint32_t DABLog::parseRecord(const byte data[], uint32_t dataSize, DABLogRecord *record) {
+
+  if (dataSize < DAB_LOG_RECORD_HEADER_LENGTH) {
+    return 0;
+  }
+  record->direction = data[0];
+  record->micros = (uint32_t)data[1] + ((uint32_t)data[2] << 8) + ((uint32_t)data[3] << 16) + ((uint32_t)data[4] << 24);
+  record->frameSize = (uint16_t)data[5] + ((uint16_t)data[6] << 8);
+  record->frame = data + DAB_LOG_RECORD_HEADER_LENGTH;
+  if (dataSize - DAB_LOG_RECORD_HEADER_LENGTH < record->frameSize) {
+    return 0;
+  }
+  return DAB_LOG_RECORD_HEADER_LENGTH + record->frameSize;
+}
+
+void DABLog::put(const byte data[], uint16_t dataSize) {
+
+  for (uint16_t i = 0; i < dataSize; i++) {
+    buffer[(head + length++) % DAB_LOG_BUFFER_SIZE] = data[i];
+  }
+}
+
+uint16_t DABLog::recordLength(uint16_t position) {
+
+  uint16_t sizeLo = buffer[(position + 5) % DAB_LOG_BUFFER_SIZE];
+  uint16_t sizeHi = buffer[(position + 6) % DAB_LOG_BUFFER_SIZE];
+  return DAB_LOG_RECORD_HEADER_LENGTH + sizeLo + (sizeHi << 8);
+}
@@ -0,0 +1,68 @@
+/*
+ * DABLog.h - Serial link log for DABDUINO library.
+ * Records every frame sent to and all raw bytes received from module (see
+ * DABDUINO::setTap) into a RAM ring buffer or to a writer (SD card File,
+ * host file). Has no hardware dependency, logs are replayed on host by
+ * extras/frame_replay.cpp, which splits received bytes into frames.
+ *
+ * Record: direction (1 byte, DAB_FRAME_TX/RX), micros (4 bytes LE),
+ * size (2 bytes LE), TX: frame FE..FD, RX: received bytes
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef DABLog_h
+#define DABLog_h
+
+#include "DABParser.h"
+
+#ifndef DAB_LOG_BUFFER_SIZE
+#define DAB_LOG_BUFFER_SIZE 1024 // RAM ring buffer, oldest records are dropped
+#endif
+#define DAB_LOG_RECORD_HEADER_LENGTH 7
+
+struct DABLogRecord
+{
+  uint8_t direction; // DAB_FRAME_TX, DAB_FRAME_RX
+  uint32_t micros;
+  uint16_t frameSize;
+  const byte *frame; // TX: frame FE..FD, RX: received bytes
+};
+
+/*
+ * Receiver of log records written outside RAM buffer
+ * e.g. SD card: ((File *)context)->write(data, dataSize)
+ */
+typedef void (*DABLogWriter)(void *context, const byte data[], uint16_t dataSize);
+
+class DABLog
+{
+public:
+
+  DABLog();
+
+  void setWriter(DABLogWriter writer, void *context);
+  void record(uint8_t direction, uint32_t micros, const byte frame[], uint16_t frameSize);
+  static void tap(void *context, uint8_t direction, uint32_t micros, const byte frame[], uint16_t frameSize);
+
+  uint16_t getLength();
+  uint16_t read(byte data[], uint16_t dataSize);
+  void clear();
+  uint32_t getRecords();
+  uint32_t getDropped();
+
+  static uint32_t parseRecord(const byte data[], uint32_t dataSize, DABLogRecord *record);
+
+private:
+  void put(const byte data[], uint16_t dataSize);
+  uint16_t recordLength(uint16_t position);
+
+  DABLogWriter writer;
+  void *writerContext;
+  byte buffer[DAB_LOG_BUFFER_SIZE];
+  uint16_t head; // oldest record
+  uint16_t length;
+  uint32_t records;
+  uint32_t dropped;
+};
+
+#endif
@@ -0,0 +1,484 @@
+/*
+ * DABMOT.cpp - MOT (Multimedia Object Transfer) slideshow decoder for DABDUINO library.
+ * MSC data group: ETSI EN 300 401, MOT: ETSI EN 301 234
+ * @license  BSD (see license.txt)
+ */
+
+#include "DABMOT.h"
+
+DABMOT::DABMOT() {
+
+  sink = NULL;
+  sinkContext = NULL;
+  memset(&stats, 0, sizeof(stats));
+  reset();
+}
+
+/*
+ * Set sink for object body
+ * sink = function called with body data, NULL=body is collected in arena (getObject)
+ */
+void DABMOT::setSink(DABMOTSink sink, void *context) {
+
+  this->sink = sink;
+  sinkContext = context;
+}
+
+/*
+ * Forget current object and directory (after retune)
+ */
+void DABMOT::reset() {
+
+  resetObject();
+  hasDirectory = false;
+  directoryStarted = false;
+  entriesCount = 0;
+}
+
+/*
+ * Forget current object
+ */
+void DABMOT::resetObject() {
+
+  hasHeader = false;
+  complete = false;
+  rejected = false;
+  nextSegment = 0;
+  segmentSize = 0;
+  memset(&object, 0, sizeof(object));
+  memset(segmentMap, 0, sizeof(segmentMap));
+  memset(slots, 0, sizeof(slots));
+}
+
+/*
+ * Decode one MSC data group
+ * return: 1=data group used, 0=data group ignored
+ */
+int8_t DABMOT::feedDataGroup(const byte data[], uint16_t dataSize) {
+
+  if (dataSize < 2) return 0;
+  stats.dataGroups++;
+  boolean extensionFlag = (data[0] >> 7) & 0x01;
+  boolean crcFlag = (data[0] >> 6) & 0x01;
+  boolean segmentFlag = (data[0] >> 5) & 0x01;
+  boolean userAccessFlag = (data[0] >> 4) & 0x01;
+  byte type = data[0] & 0x0F;
+  uint16_t index = 2;
+  if (extensionFlag) index += 2;
+  if (crcFlag) {
+    if (dataSize < 4) return 0;
+    dataSize -= 2;
+    if (crc16(data, dataSize) != (uint16_t)((data[dataSize] << 8) + data[dataSize + 1])) {
+      stats.crcErrors++;
+      return 0;
+    }
+  }
+
+  // session header
+  boolean last = false;
+  uint16_t segmentNumber = 0;
+  if (segmentFlag) {
+    if (index + 2 > dataSize) return 0;
+    last = (data[index] >> 7) & 0x01;
+    segmentNumber = ((data[index] & 0x7F) << 8) + data[index + 1];
+    index += 2;
+  }
+  if (!userAccessFlag || index + 1 > dataSize) return 0;
+  boolean transportIdFlag = (data[index] >> 4) & 0x01;
+  byte lengthIndicator = data[index] & 0x0F;
+  if (!transportIdFlag || lengthIndicator < 2 || index + 1 + lengthIndicator > dataSize) return 0;
+  uint16_t transportId = (data[index + 1] << 8) + data[index + 2];
+  index += 1 + lengthIndicator;
+
+  // segmentation header
+  if (index + 2 > dataSize) return 0;
+  uint16_t segmentSize = ((data[index] & 0x1F) << 8) + data[index + 1];
+  index += 2;
+  if (index + segmentSize > dataSize) return 0;
+
+  switch (type) {
+  case DAB_MOT_HEADER:
+    // header mode (slideshow): header fits into one segment
+    if (segmentNumber != 0 || !last) return 0;
+    if (hasHeader && transportId == object.transportId) {
+      if (!complete && !rejected) object.repeats++; // carousel repeat
+      return 1;
+    }
+    if (hasHeader && !complete && !rejected) stats.objectsAborted++;
+    resetObject();
+    object.transportId = transportId;
+    return parseHeader(&data[index], segmentSize);
+  case DAB_MOT_BODY:
+    if (!hasHeader || complete || transportId != object.transportId) {
+      // directory mode: header of object is in directory
+      if (!startEntry(transportId)) return 0;
+    }
+    if (rejected) return 0;
+    bodySegment(segmentNumber, last, &data[index], segmentSize);
+    return 1;
+  case DAB_MOT_DIRECTORY:
+    directorySegment(transportId, segmentNumber, last, &data[index], segmentSize);
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * Decode captured SPI stream - data groups with 2 byte length prefix
+ * return: number of decoded data groups
+ */
+uint32_t DABMOT::feedStream(const byte stream[], uint32_t streamSize) {
+
+  uint32_t index = 0;
+  uint32_t count = 0;
+  while (index + 2 <= streamSize) {
+    uint16_t length = (stream[index] << 8) + stream[index + 1];
+    index += 2;
+    if (index + length > streamSize) break;
+    count += feedDataGroup(&stream[index], length);
+    index += length;
+  }
+  return count;
+}
+
+/*
+ * Get complete object collected in arena (no sink is set)
+ * return: 1=object complete, 0=no object
+ */
+int8_t DABMOT::getObject(const DABMOTObject **object, const byte **data) {
+
+  if (!complete || sink) return 0;
+  *object = &this->object;
+  *data = arena;
+  return 1;
+}
+
+/*
+ * Get decoder counters
+ */
+const DABMOTStats *DABMOT::getStats() {
+
+  return &stats;
+}
+
+/*
+ * Get number of segments of current object still missing
+ * return: missing segments, 0xFFFF=unknown (last segment not received yet)
+ */
+uint16_t DABMOT::getMissingSegments() {
+
+  if (!object.segmentCount) return 0xFFFF;
+  uint16_t missing = 0;
+  for (uint16_t i = 0; i < object.segmentCount; i++) {
+    if (!isReceived(i)) missing++;
+  }
+  return missing;
+}
+
+/*
+ * CRC of MSC data group (CRC-16-CCITT, inverted)
+ */
+uint16_t DABMOT::crc16(const byte data[], uint16_t dataSize) {
+
+  uint16_t crc = 0xFFFF;
+  for (uint16_t i = 0; i < dataSize; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (byte bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+  }
+  return crc ^ 0xFFFF;
+}
+
+/*
+ * Parse MOT header core and ContentName parameter
+ */
+int8_t DABMOT::parseHeader(const byte data[], uint16_t dataSize) {
+
+  if (dataSize < 7) return 0;
+  object.bodySize = ((uint32_t)data[0] << 20) + ((uint32_t)data[1] << 12) + ((uint32_t)data[2] << 4) + (data[3] >> 4);
+  uint16_t size = ((data[3] & 0x0F) << 9) + (data[4] << 1) + (data[5] >> 7);
+  object.contentType = (data[5] >> 1) & 0x3F;
+  object.contentSubType = ((data[5] & 0x01) << 8) + data[6];
+  if (size > dataSize) return 0;
+
+  // header extension
+  uint16_t index = 7;
+  while (index < size) {
+    byte pli = data[index] >> 6;
+    byte paramId = data[index] & 0x3F;
+    index++;
+    uint16_t length = 0;
+    switch (pli) {
+    case 1: length = 1; break;
+    case 2: length = 4; break;
+    case 3:
+      if (index >= size) return 0;
+      if (data[index] & 0x80) {
+        if (index + 1 >= size) return 0;
+        length = ((data[index] & 0x7F) << 8) + data[index + 1];
+        index += 2;
+      } else {
+        length = data[index];
+        index++;
+      }
+      break;
+    }
+    if (index + length > size) return 0;
+    if (paramId == 0x0C && length > 1) { // ContentName (1st byte is charset)
+      uint16_t nameLength = length - 1;
+      if (nameLength > DAB_MOT_MAX_NAME_LENGTH) nameLength = DAB_MOT_MAX_NAME_LENGTH;
+      memcpy(object.contentName, &data[index + 1], nameLength);
+      object.contentName[nameLength] = 0x00;
+    }
+    index += length;
+  }
+
+  hasHeader = true;
+  if (!sink && object.bodySize > DAB_MOT_ARENA_SIZE) {
+    rejectObject(); // body can never fit
+  }
+  return 1;
+}
+
+/*
+ * Take directory segment, directory is parsed when all segments are received
+ */
+void DABMOT::directorySegment(uint16_t transportId, uint16_t segmentNumber, boolean last, const byte data[], uint16_t dataSize) {
+
+  if (hasDirectory && transportId == directoryId) return; // carousel repeat
+  if (!directoryStarted || transportId != directoryId) {
+    // new directory is assembled over the old one, its entries are gone
+    hasDirectory = false;
+    entriesCount = 0;
+    directoryStarted = true;
+    directoryId = transportId;
+    directoryReceived = 0;
+    directorySegmentSize = 0;
+    directorySegments = 0;
+    memset(directoryMap, 0, sizeof(directoryMap));
+  }
+  if (last) {
+    directorySegments = segmentNumber + 1;
+  } else if (!directorySegmentSize) {
+    directorySegmentSize = dataSize;
+  }
+  if (segmentNumber >= DAB_MOT_DIRECTORY_SEGMENTS || ((directoryMap[segmentNumber >> 3] >> (segmentNumber & 0x07)) & 0x01)) return;
+  // offset of last segment is known only with size of other segments
+  if (!directorySegmentSize && segmentNumber) return;
+  uint32_t offset = (uint32_t)segmentNumber * directorySegmentSize;
+  if (offset + dataSize > DAB_MOT_DIRECTORY_SIZE) {
+    stats.segmentsDropped++; // directory is too big
+    return;
+  }
+  memcpy(&directory[offset], data, dataSize);
+  directoryReceived += dataSize;
+  directoryMap[segmentNumber >> 3] |= (1 << (segmentNumber & 0x07));
+
+  if (!directorySegments || directorySegments > DAB_MOT_DIRECTORY_SEGMENTS) return;
+  for (uint16_t i = 0; i < directorySegments; i++) {
+    if (!((directoryMap[i >> 3] >> (i & 0x07)) & 0x01)) return;
+  }
+  directoryStarted = false;
+  hasDirectory = parseDirectory();
+  if (!hasDirectory) {
+    entriesCount = 0;
+    return;
+  }
+  stats.directories++;
+  // object in progress left carousel
+  if (hasHeader && !complete) {
+    for (uint8_t i = 0; i < entriesCount; i++) {
+      if (entries[i].transportId == object.transportId) return;
+    }
+    stats.objectsAborted++;
+    resetObject();
+  }
+}
+
+/*
+ * Parse MOT directory into entries (transport id and header of every object)
+ */
+int8_t DABMOT::parseDirectory() {
+
+  if (directoryReceived < 13) return 0;
+  uint32_t size = ((uint32_t)(directory[0] & 0x3F) << 24) + ((uint32_t)directory[1] << 16) + ((uint32_t)directory[2] << 8) + directory[3];
+  if (size > directoryReceived) return 0;
+  uint16_t objects = (directory[4] << 8) + directory[5];
+  uint32_t index = 13 + ((directory[11] << 8) + directory[12]); // skip directory extension
+  entriesCount = 0;
+  for (uint16_t i = 0; i < objects; i++) {
+    if (index + 2 + 7 > size) return 0;
+    uint16_t transportId = (directory[index] << 8) + directory[index + 1];
+    index += 2;
+    uint16_t headerSize = ((directory[index + 3] & 0x0F) << 9) + (directory[index + 4] << 1) + (directory[index + 5] >> 7);
+    if (headerSize < 7 || index + headerSize > size) return 0;
+    if (entriesCount < DAB_MOT_MAX_ENTRIES) {
+      DABMOTEntry *entry = &entries[entriesCount++];
+      entry->transportId = transportId;
+      entry->headerOffset = index;
+      entry->headerSize = headerSize;
+      entry->done = false;
+    }
+    index += headerSize;
+  }
+  return 1;
+}
+
+/*
+ * Start object listed in directory, when no other object is in progress
+ * return: 1=object started, 0=not in directory, done or other object in progress
+ */
+int8_t DABMOT::startEntry(uint16_t transportId) {
+
+  if (!hasDirectory || (hasHeader && !complete && !rejected)) return 0;
+  for (uint8_t i = 0; i < entriesCount; i++) {
+    if (entries[i].transportId == transportId) {
+      if (entries[i].done) return 0;
+      resetObject();
+      object.transportId = transportId;
+      return parseHeader(&directory[entries[i].headerOffset], entries[i].headerSize);
+    }
+  }
+  return 0;
+}
+
+/*
+ * Give up current object - header stays, so its carousel repeats are ignored;
+ * object of directory is marked done
+ */
+void DABMOT::rejectObject() {
+
+  stats.objectsRejected++;
+  rejected = true;
+  object.segmentCount = 0;
+  memset(segmentMap, 0, sizeof(segmentMap));
+  memset(slots, 0, sizeof(slots));
+  if (hasDirectory) {
+    for (uint8_t i = 0; i < entriesCount; i++) {
+      if (entries[i].transportId == object.transportId) entries[i].done = true;
+    }
+  }
+}
+
+/*
+ * Take body segment
+ * With sink: segments are delivered in order immediately, segments received
+ * ahead wait in slots, the others are taken from next carousel repeat.
+ * Without sink: segments are placed to arena at their offset.
+ */
+void DABMOT::bodySegment(uint16_t segmentNumber, boolean last, const byte data[], uint16_t dataSize) {
+
+  if (segmentNumber >= DAB_MOT_MAX_SEGMENTS) {
+    rejectObject(); // segment map is too small
+    return;
+  }
+  if (last) {
+    object.segmentCount = segmentNumber + 1;
+  } else if (!segmentSize) {
+    segmentSize = dataSize;
+  }
+  if (isReceived(segmentNumber)) return;
+
+  if (sink) {
+    if (segmentNumber == nextSegment) {
+      deliver(data, dataSize);
+      setReceived(segmentNumber);
+      // drain slots
+      boolean found = true;
+      while (found) {
+        found = false;
+        for (byte i = 0; i < DAB_MOT_SEGMENT_SLOTS; i++) {
+          if (slots[i].used && slots[i].segmentNumber == nextSegment) {
+            deliver(&arena[i * DAB_MOT_SLOT_SIZE], slots[i].size);
+            slots[i].used = false;
+            found = true;
+          }
+        }
+      }
+    } else {
+      if (dataSize > DAB_MOT_SLOT_SIZE) {
+        stats.segmentsDropped++;
+        return;
+      }
+      // free slot, or slot of the farthest segment when it is behind this one
+      byte i = 0;
+      byte farthest = 0;
+      while (i < DAB_MOT_SEGMENT_SLOTS && slots[i].used) {
+        if (slots[i].segmentNumber > slots[farthest].segmentNumber) farthest = i;
+        i++;
+      }
+      if (i == DAB_MOT_SEGMENT_SLOTS && slots[farthest].segmentNumber > segmentNumber) {
+        i = farthest;
+        clearReceived(slots[i].segmentNumber);
+        stats.segmentsDropped++;
+      }
+      if (i == DAB_MOT_SEGMENT_SLOTS) {
+        stats.segmentsDropped++;
+        return;
+      }
+      memcpy(&arena[i * DAB_MOT_SLOT_SIZE], data, dataSize);
+      slots[i].segmentNumber = segmentNumber;
+      slots[i].size = dataSize;
+      slots[i].used = true;
+      setReceived(segmentNumber);
+    }
+  } else {
+    // offset of last segment is known only with size of other segments
+    if (!segmentSize && segmentNumber) return;
+    uint32_t offset = (uint32_t)segmentNumber * segmentSize;
+    if (offset + dataSize > DAB_MOT_ARENA_SIZE) {
+      stats.segmentsDropped++; // object is too big for arena
+      return;
+    }
+    memcpy(&arena[offset], data, dataSize);
+    object.received += dataSize;
+    setReceived(segmentNumber);
+  }
+  checkComplete();
+}
+
+void DABMOT::deliver(const byte data[], uint16_t dataSize) {
+
+  sink(sinkContext, &object, data, dataSize);
+  object.received += dataSize;
+  nextSegment++;
+}
+
+void DABMOT::checkComplete() {
+
+  if (!object.segmentCount || getMissingSegments()) return;
+  complete = (object.received == object.bodySize);
+  if (!complete) {
+    // segments did not match header, start again
+    object.received = 0;
+    nextSegment = 0;
+    memset(segmentMap, 0, sizeof(segmentMap));
+    return;
+  }
+  stats.objectsComplete++;
+  stats.repeats += object.repeats;
+  if (hasDirectory) {
+    for (uint8_t i = 0; i < entriesCount; i++) {
+      if (entries[i].transportId == object.transportId) entries[i].done = true;
+    }
+  }
+  if (sink) {
+    sink(sinkContext, &object, NULL, 0);
+  }
+}
+
+boolean DABMOT::isReceived(uint16_t segmentNumber) {
+
+  return (segmentMap[segmentNumber >> 3] >> (segmentNumber & 0x07)) & 0x01;
+}
+
+void DABMOT::setReceived(uint16_t segmentNumber) {
+
+  segmentMap[segmentNumber >> 3] |= (1 << (segmentNumber & 0x07));
+}
+
+void DABMOT::clearReceived(uint16_t segmentNumber) {
+
+  segmentMap[segmentNumber >> 3] &= ~(1 << (segmentNumber & 0x07));
+}
@@ -0,0 +1,155 @@
+/*
+ * DABMOT.h - MOT (Multimedia Object Transfer) slideshow decoder for DABDUINO library.
+ * Decodes MSC data groups read from module SPI (see DABDUINO::pollMOT) and
+ * hands slide data to application. Header mode (slideshow) and directory
+ * mode (EPG/SPI carousel) are decoded; directory mode objects are taken one
+ * after other, so set sink to see every object. Has no hardware dependency,
+ * so captured SPI streams can be replayed on host (see extras/mot_replay.cpp).
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef DABMOT_h
+#define DABMOT_h
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include <stdint.h>
+#include <string.h>
+typedef uint8_t byte;
+typedef bool boolean;
+#endif
+
+#ifndef DAB_MOT_ARENA_SIZE
+#define DAB_MOT_ARENA_SIZE 4096 // whole body when no sink is set, else segment slots
+#endif
+#ifndef DAB_MOT_SEGMENT_SLOTS
+#define DAB_MOT_SEGMENT_SLOTS 4 // segments received out of order (sink is set)
+#endif
+#define DAB_MOT_SLOT_SIZE (DAB_MOT_ARENA_SIZE / DAB_MOT_SEGMENT_SLOTS)
+#define DAB_MOT_MAX_SEGMENTS 512
+#define DAB_MOT_MAX_NAME_LENGTH 32
+#ifndef DAB_MOT_DIRECTORY_SIZE
+#define DAB_MOT_DIRECTORY_SIZE 2048 // MOT directory of directory mode carousel (EPG/SPI)
+#endif
+#define DAB_MOT_DIRECTORY_SEGMENTS 64
+#define DAB_MOT_MAX_ENTRIES 32 // objects of directory
+
+// MOT data group types
+#define DAB_MOT_HEADER 3
+#define DAB_MOT_BODY 4
+#define DAB_MOT_DIRECTORY 6 // uncompressed
+
+// MOT content types
+#define DAB_MOT_TYPE_IMAGE 2
+#define DAB_MOT_SUBTYPE_JPEG 1
+#define DAB_MOT_SUBTYPE_PNG 3
+#define DAB_MOT_TYPE_EPG 7 // SPI (ETSI TS 102 371)
+
+struct DABMOTObject
+{
+  uint16_t transportId;
+  uint32_t bodySize;
+  uint8_t contentType;
+  uint16_t contentSubType;
+  char contentName[DAB_MOT_MAX_NAME_LENGTH + 1];
+  uint32_t received; // body bytes received (with sink: delivered in order)
+  uint16_t segmentCount; // 0=last segment not received yet
+  uint16_t repeats; // carousel repeats needed for object
+};
+
+struct DABMOTSlot
+{
+  uint16_t segmentNumber;
+  uint16_t size;
+  boolean used;
+};
+
+struct DABMOTEntry
+{
+  uint16_t transportId;
+  uint16_t headerOffset; // MOT header in directory
+  uint16_t headerSize;
+  boolean done; // object complete
+};
+
+struct DABMOTStats
+{
+  uint32_t dataGroups;
+  uint32_t crcErrors;
+  uint32_t segmentsDropped; // no free slot, taken from carousel repeat
+  uint16_t objectsComplete;
+  uint16_t objectsAborted; // new object started before previous was complete
+  uint16_t objectsRejected; // more than DAB_MOT_MAX_SEGMENTS segments, or body bigger than arena without sink
+  uint32_t repeats; // carousel repeats needed for all complete objects
+  uint16_t directories; // complete MOT directories
+};
+
+/*
+ * Sink for object body
+ * called with body data in order, object->received is offset of data
+ * (offset 0 = start or restart of object), dataSize=0 when object is complete
+ */
+typedef void (*DABMOTSink)(void *context, const DABMOTObject *object, const byte data[], uint16_t dataSize);
+
+class DABMOT
+{
+public:
+
+  DABMOT();
+
+  void setSink(DABMOTSink sink, void *context);
+  void reset();
+
+  int8_t feedDataGroup(const byte data[], uint16_t dataSize);
+  uint32_t feedStream(const byte stream[], uint32_t streamSize);
+
+  int8_t getObject(const DABMOTObject **object, const byte **data);
+  const DABMOTStats *getStats();
+  uint16_t getMissingSegments();
+
+  static uint16_t crc16(const byte data[], uint16_t dataSize);
+
+private:
+  void resetObject();
+  int8_t parseHeader(const byte data[], uint16_t dataSize);
+  void directorySegment(uint16_t transportId, uint16_t segmentNumber, boolean last, const byte data[], uint16_t dataSize);
+  int8_t parseDirectory();
+  int8_t startEntry(uint16_t transportId);
+  void rejectObject();
+  void bodySegment(uint16_t segmentNumber, boolean last, const byte data[], uint16_t dataSize);
+  void deliver(const byte data[], uint16_t dataSize);
+  void checkComplete();
+  boolean isReceived(uint16_t segmentNumber);
+  void setReceived(uint16_t segmentNumber);
+  void clearReceived(uint16_t segmentNumber);
+
+  DABMOTSink sink;
+  void *sinkContext;
+
+  DABMOTObject object;
+  boolean hasHeader;
+  boolean complete;
+  boolean rejected; // object can not be decoded, its segments are ignored
+  uint16_t nextSegment; // next segment for sink
+  uint16_t segmentSize; // size of all segments except last, 0=unknown
+  byte segmentMap[DAB_MOT_MAX_SEGMENTS / 8]; // received segments
+  DABMOTSlot slots[DAB_MOT_SEGMENT_SLOTS];
+  DABMOTStats stats;
+
+  // directory mode
+  boolean hasDirectory; // complete directory in entries
+  boolean directoryStarted;
+  uint16_t directoryId;
+  uint32_t directoryReceived;
+  uint16_t directorySegmentSize; // 0=unknown
+  uint16_t directorySegments; // 0=last segment not received yet
+  byte directoryMap[DAB_MOT_DIRECTORY_SEGMENTS / 8];
+  DABMOTEntry entries[DAB_MOT_MAX_ENTRIES];
+  uint8_t entriesCount;
+  byte directory[DAB_MOT_DIRECTORY_SIZE];
+
+  byte arena[DAB_MOT_ARENA_SIZE];
+};
+
+#endif
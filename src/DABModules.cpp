@@ -0,0 +1,120 @@
+/*
+ * DABModules.cpp - Multi-module manager for DABDUINO library.
+ * @license  BSD (see license.txt)
+ */
+
+#include "DABModules.h"
+
+DABModules::DABModules() {
+
+  count = 0;
+  nextEvent = 0;
+  memset(events, 0, sizeof(events));
+}
+
+/*
+ * Add initialized module
+ * return: module index, -1=too many modules
+ */
+int8_t DABModules::add(DABDUINO& dab) {
+
+  if (count == DAB_MAX_MODULES) {
+    return -1;
+  }
+  modules[count] = &dab;
+  events[count] = 0;
+  return count++;
+}
+
+uint8_t DABModules::getCount() {
+
+  return count;
+}
+
+DABDUINO *DABModules::getModule(uint8_t module) {
+
+  return (module < count) ? modules[module] : NULL;
+}
+
+/*
+ * Service all modules - receive answers and events, send next queued commands.
+ * Call often from loop(), modules work in parallel while no blocking
+ * command (sendCommand and getters) is used.
+ */
+void DABModules::poll() {
+
+  for (uint8_t i = 0; i < count; i++) {
+    modules[i]->poll();
+  }
+}
+
+/*
+ * Read next event of any module, modules are taken round robin so busy
+ * module does not starve the others
+ * module = index of module the event comes from
+ * return: 1=event, 0=no event
+ */
+int8_t DABModules::readEvent(DABEvent *event, uint8_t *module) {
+
+  for (uint8_t i = 0; i < count; i++) {
+    uint8_t index = (nextEvent + i) % count;
+    if (modules[index]->getEvent(event)) {
+      *module = index;
+      events[index]++;
+      nextEvent = (index + 1) % count;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Get number of commands waiting in all modules
+ */
+uint8_t DABModules::getQueueLength() {
+
+  uint8_t length = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    length += modules[i]->getQueueLength();
+  }
+  return length;
+}
+
+/*
+ * Get statistics of one module, queue stats are summed over priorities
+ * return: 1=ok, 0=no such module
+ */
+int8_t DABModules::getStats(uint8_t module, DABModuleStats *stats) {
+
+  if (module >= count) {
+    return 0;
+  }
+  DABDUINO *dab = modules[module];
+  const DABLinkStats *link = dab->getLinkStats();
+  memset(stats, 0, sizeof(DABModuleStats));
+  stats->exchanges = link->exchanges;
+  stats->cacheHits = link->cacheHits;
+  for (uint8_t priority = 0; priority < DAB_PRIORITIES; priority++) {
+    const DABQueueStats *queueStats = dab->getQueueStats(priority);
+    stats->commands += queueStats->commands;
+    stats->totalLatency += queueStats->totalLatency;
+    if (queueStats->maxLatency > stats->maxLatency) {
+      stats->maxLatency = queueStats->maxLatency;
+    }
+    stats->dropped += queueStats->dropped;
+  }
+  stats->events = events[module];
+  stats->queueLength = dab->getQueueLength();
+  return 1;
+}
+
+/*
+ * Reset queue and event statistics of all modules
+ */
+void DABModules::resetStats() {
+
+  for (uint8_t i = 0; i < count; i++) {
+    modules[i]->resetQueueStats();
+    events[i] = 0;
+  }
+}
@@ -0,0 +1,51 @@
+/*
+ * DABModules.h - Multi-module manager for DABDUINO library.
+ * Drives non-blocking engines of several DABDUINO modules (each on own
+ * serial port) from one poll() loop and merges their events.
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef DABModules_h
+#define DABModules_h
+
+#include "DABDUINO.h"
+
+#define DAB_MAX_MODULES 4
+
+struct DABModuleStats
+{
+  uint32_t exchanges; // commands sent to module
+  uint32_t cacheHits;
+  uint32_t commands; // queued commands answered or timed out
+  uint32_t totalLatency; // from queueCommand to answer (ms)
+  uint16_t maxLatency; // ms
+  uint16_t dropped; // queue was full
+  uint32_t events; // events read by readEvent
+  uint8_t queueLength; // commands waiting now
+};
+
+class DABModules
+{
+public:
+
+  DABModules();
+
+  int8_t add(DABDUINO& dab);
+  uint8_t getCount();
+  DABDUINO *getModule(uint8_t module);
+
+  void poll();
+  int8_t readEvent(DABEvent *event, uint8_t *module);
+  uint8_t getQueueLength();
+
+  int8_t getStats(uint8_t module, DABModuleStats *stats);
+  void resetStats();
+
+private:
+  DABDUINO *modules[DAB_MAX_MODULES];
+  uint32_t events[DAB_MAX_MODULES];
+  uint8_t count;
+  uint8_t nextEvent; // module asked first by readEvent
+};
+
+#endif
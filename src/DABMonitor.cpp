@@ -0,0 +1,251 @@
+/*
+ * DABMonitor.cpp - Multiplex monitoring for DABDUINO library.
+ * @license  BSD (see license.txt)
+ */
+
+#include "DABMonitor.h"
+
+DABMonitor::DABMonitor(DABDUINO& dab, DABStations *stations) {
+
+  this->dab = &dab;
+  this->stations = stations;
+  log = NULL;
+  clock = NULL;
+  dwellTime = DAB_MONITOR_DWELL;
+  programCount = 0;
+  running = false;
+  cycles = 0;
+  rtcValid = false;
+}
+
+/*
+ * Set time on one service before measuring (ms)
+ */
+void DABMonitor::setDwellTime(uint16_t dwellTime) {
+
+  this->dwellTime = dwellTime;
+}
+
+/*
+ * Set log for binary records (e.g. SD card File), NULL=no log
+ */
+void DABMonitor::setLog(Print *log) {
+
+  this->log = log;
+}
+
+/*
+ * Set time service, records take time from it instead of RTC read per cycle
+ */
+void DABMonitor::setClock(DABClock *clock) {
+
+  this->clock = clock;
+}
+
+/*
+ * Start monitoring of cached stations with known frequency
+ * (load stations with DAB_STATION_INFO | DAB_STATION_FREQUENCY before)
+ * return: 1=ok, 0=no station to monitor or tune error
+ */
+int8_t DABMonitor::start() {
+
+  order();
+  if (!programCount) {
+    return 0;
+  }
+  position = 0;
+  reverse = false;
+  cycles = 0;
+  running = true;
+  readTime();
+  return tuneNext();
+}
+
+void DABMonitor::stop() {
+
+  running = false;
+}
+
+boolean DABMonitor::isRunning() {
+
+  return running;
+}
+
+/*
+ * Number of finished cycles over all stations
+ */
+uint32_t DABMonitor::getCycles() {
+
+  return cycles;
+}
+
+/*
+ * Call often from loop() - after dwell time measures current service,
+ * writes record to log and tunes next service
+ * record = measured values
+ * return: 1=new record, 0=nothing measured
+ */
+int8_t DABMonitor::poll(DABMonitorRecord *record) {
+
+  if (!running || millis() - tuneMillis < dwellTime) {
+    return 0;
+  }
+  measure(record);
+  if (log) {
+    writeRecord(log, record);
+  }
+  if (++position == programCount) {
+    // next cycle runs backwards from the service just measured, it stays tuned
+    position = 0;
+    reverse = !reverse;
+    cycles++;
+    readTime();
+    if (!tuneFailed) {
+      tuneMillis = millis();
+      return 1;
+    }
+  }
+  tuneNext();
+  return 1;
+}
+
+/*
+ * Sort stations by frequency index (insertion sort, stable), so every
+ * multiplex is tuned once per cycle and services in it follow each other
+ */
+void DABMonitor::order() {
+
+  programCount = 0;
+  for (uint16_t program = 0; program < stations->getCount(); program++) {
+    DABStation *station = stations->getStation(program);
+    if (!station || !(station->valid & DAB_STATION_FREQUENCY)) {
+      continue;
+    }
+    uint8_t i = programCount++;
+    while (i > 0 && stations->getStation(programs[i - 1])->frequencyIndex > station->frequencyIndex) {
+      programs[i] = programs[i - 1];
+      i--;
+    }
+    programs[i] = program;
+  }
+}
+
+int8_t DABMonitor::tuneNext() {
+
+  uint8_t program = programs[reverse ? programCount - 1 - position : position];
+  tuneFailed = !dab->playDAB(program);
+  tuneMillis = millis();
+  return tuneFailed ? 0 : 1;
+}
+
+/*
+ * Measure current service - signal strength, quality and data rate in one
+ * pipelined batch
+ * return: 1=ok, 0=error
+ */
+int8_t DABMonitor::measure(DABMonitorRecord *record) {
+
+  uint8_t program = programs[reverse ? programCount - 1 - position : position];
+  DABStation *station = stations->getStation(program);
+  memset(record, 0, sizeof(DABMonitorRecord));
+  record->serviceId = station->serviceId;
+  record->ensembleId = station->ensembleId;
+  record->frequencyIndex = station->frequencyIndex;
+  if (clock && clock->isValid()) {
+    record->time = clock->now() - DAB_EPOCH_2000;
+  } else if (rtcValid) {
+    record->time = rtcSeconds + (millis() - rtcMillis) / 1000;
+  } else {
+    record->time = (millis() - rtcMillis) / 1000;
+    record->flags |= DAB_MONITOR_NO_TIME;
+  }
+  if (tuneFailed) {
+    record->flags |= DAB_MONITOR_TUNE_FAILED;
+    return 0;
+  }
+  byte dabCommands[3][7] = {
+    { 0xFE, 0x01, 0x08, 0x00, 0x00, 0x00, 0xFD }, // getSignalStrength
+    { 0xFE, 0x01, 0x13, 0x00, 0x00, 0x00, 0xFD }, // getSignalQuality
+    { 0xFE, 0x01, 0x12, 0x00, 0x00, 0x00, 0xFD } // getDataRate
+  };
+  byte *commands[3] = { dabCommands[0], dabCommands[1], dabCommands[2] };
+  if (dab->sendCommands(commands, 3, response, record) != 3) {
+    record->flags |= DAB_MONITOR_MEASURE_FAILED;
+    return 0;
+  }
+  return 1;
+}
+
+void DABMonitor::response(void *context, uint8_t index, int8_t status, byte dabData[], uint32_t dabDataSize) {
+
+  DABMonitorRecord *record = (DABMonitorRecord *)context;
+  if (!status || dabDataSize < 1) {
+    return;
+  }
+  switch (index) {
+  case 0:
+    record->signalStrength = dabData[0];
+    if (dabDataSize > 2) {
+      record->bitErrorRate = ((uint16_t)dabData[1] << 8) + dabData[2];
+    }
+    break;
+  case 1:
+    record->signalQuality = dabData[0];
+    break;
+  case 2:
+    if (dabDataSize > 1) {
+      record->dataRate = ((uint16_t)dabData[0] << 8) + dabData[1];
+    }
+    break;
+  }
+}
+
+/*
+ * Read module RTC, record time between reads is extrapolated by millis()
+ */
+void DABMonitor::readTime() {
+
+  if (clock) {
+    clock->poll();
+    if (clock->isValid()) {
+      return;
+    }
+  }
+  DABRtcTime time = dab->getRTCclock();
+  rtcMillis = millis();
+  rtcValid = (time.status == DAB_STATUS_OK);
+  if (rtcValid) {
+    rtcSeconds = toSeconds(&time);
+  }
+}
+
+/*
+ * Write record to log, little endian (DAB_MONITOR_RECORD_SIZE bytes)
+ */
+void DABMonitor::writeRecord(Print *log, const DABMonitorRecord *record) {
+
+  byte data[DAB_MONITOR_RECORD_SIZE];
+  for (uint8_t i = 0; i < 4; i++) {
+    data[i] = (record->time >> (8 * i)) & 0xFF;
+    data[4 + i] = (record->serviceId >> (8 * i)) & 0xFF;
+  }
+  data[8] = record->ensembleId & 0xFF;
+  data[9] = record->ensembleId >> 8;
+  data[10] = record->frequencyIndex;
+  data[11] = record->signalStrength;
+  data[12] = record->bitErrorRate & 0xFF;
+  data[13] = record->bitErrorRate >> 8;
+  data[14] = record->signalQuality;
+  data[15] = record->flags;
+  data[16] = record->dataRate & 0xFF;
+  data[17] = record->dataRate >> 8;
+  log->write(data, DAB_MONITOR_RECORD_SIZE);
+}
+
+/*
+ * Convert RTC time to seconds since 2000-01-01 00:00:00
+ */
+uint32_t DABMonitor::toSeconds(const DABRtcTime *time) {
+
+  return DABClock::toEpoch(time) - DAB_EPOCH_2000;
+}
@@ -0,0 +1,85 @@
+/*
+ * DABMonitor.h - Multiplex monitoring for DABDUINO library.
+ * Cycles through all cached services and logs signal strength, bit error
+ * rate, signal quality and data rate with RTC time as compact binary records.
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef DABMonitor_h
+#define DABMonitor_h
+
+#include "DABDUINO.h"
+#include "DABStations.h"
+#include "DABClock.h"
+
+#define DAB_MONITOR_DWELL 1000 // default time on one service before measuring (ms)
+#define DAB_MONITOR_RECORD_SIZE 18 // bytes of one log record
+
+// record flags
+#define DAB_MONITOR_TUNE_FAILED 0x01
+#define DAB_MONITOR_MEASURE_FAILED 0x02
+#define DAB_MONITOR_NO_TIME 0x04 // RTC not read, time is seconds since start
+
+/*
+ * Log record, written little endian in this order (DAB_MONITOR_RECORD_SIZE bytes)
+ */
+struct DABMonitorRecord
+{
+  uint32_t time; // seconds since 2000-01-01 00:00:00 (module RTC)
+  uint32_t serviceId;
+  uint16_t ensembleId;
+  uint8_t frequencyIndex; // see getFrequency
+  uint8_t signalStrength; // 0..18
+  uint16_t bitErrorRate;
+  uint8_t signalQuality; // 0..100
+  uint8_t flags; // DAB_MONITOR_*
+  uint16_t dataRate; // kbps
+};
+
+class DABMonitor
+{
+public:
+
+  DABMonitor(DABDUINO& dab, DABStations *stations);
+
+  void setDwellTime(uint16_t dwellTime);
+  void setLog(Print *log);
+  void setClock(DABClock *clock);
+
+  int8_t start();
+  void stop();
+  boolean isRunning();
+  int8_t poll(DABMonitorRecord *record);
+  uint32_t getCycles();
+
+  static void writeRecord(Print *log, const DABMonitorRecord *record);
+  static uint32_t toSeconds(const DABRtcTime *time);
+
+private:
+  void order();
+  int8_t tuneNext();
+  int8_t measure(DABMonitorRecord *record);
+  void readTime();
+  static void response(void *context, uint8_t index, int8_t status, byte dabData[], uint32_t dabDataSize);
+
+  DABDUINO *dab;
+  DABStations *stations;
+  Print *log;
+  DABClock *clock;
+  uint16_t dwellTime;
+
+  uint8_t programs[DAB_MAX_STATIONS]; // program indexes sorted by frequency index
+  uint8_t programCount;
+  uint8_t position;
+  boolean reverse; // every other cycle runs backwards, multiplex on both ends is tuned once
+  boolean running;
+  boolean tuneFailed;
+  unsigned long tuneMillis;
+  uint32_t cycles;
+
+  uint32_t rtcSeconds;
+  unsigned long rtcMillis;
+  boolean rtcValid;
+};
+
+#endif
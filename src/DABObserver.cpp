@@ -0,0 +1,157 @@
+/*
+ * DABObserver.cpp - Typed event dispatch for DABDUINO library.
+ * @license  BSD (see license.txt)
+ */
+
+#include "DABObserver.h"
+
+DABObserver::DABObserver(DABDUINO& dab) {
+
+  this->dab = &dab;
+  memset(observers, 0, sizeof(observers));
+  prefetch = DAB_OBSERVER_PREFETCH;
+  fetching = 0;
+}
+
+/*
+ * Register observer of events in mask (DAB_EVENT_*), call begin() after
+ * return: 1=ok, 0=too many observers
+ */
+int8_t DABObserver::subscribe(uint16_t mask, DABObserverHandler handler, void *context) {
+
+  for (uint8_t i = 0; i < DAB_MAX_OBSERVERS; i++) {
+    if (!observers[i].handler) {
+      observers[i].mask = mask;
+      observers[i].handler = handler;
+      observers[i].context = context;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+void DABObserver::unsubscribe(DABObserverHandler handler, void *context) {
+
+  for (uint8_t i = 0; i < DAB_MAX_OBSERVERS; i++) {
+    if (observers[i].handler == handler && observers[i].context == context) {
+      observers[i].handler = NULL;
+    }
+  }
+}
+
+/*
+ * Set events with payload fetched before dispatch (default DAB_OBSERVER_PREFETCH),
+ * other events are dispatched at once with status 0
+ */
+void DABObserver::setPrefetch(uint16_t mask) {
+
+  prefetch = mask;
+}
+
+/*
+ * Subscribe module to events of all observers and take them over from
+ * DABDUINO event queue
+ * return: 1=ok, 0=error
+ */
+int8_t DABObserver::begin() {
+
+  uint16_t mask = 0;
+  for (uint8_t i = 0; i < DAB_MAX_OBSERVERS; i++) {
+    if (observers[i].handler) {
+      mask |= observers[i].mask;
+    }
+  }
+  for (int8_t type = 1; type <= DAB_EVENT_TYPES; type++) {
+    dab->setEventHandler(type, (mask & DAB_EVENT_FLAG(type)) ? eventReceived : NULL, this);
+  }
+  return dab->setEventMask(mask);
+}
+
+void DABObserver::dispatch(const DABTypedEvent *event) {
+
+  for (uint8_t i = 0; i < DAB_MAX_OBSERVERS; i++) {
+    if (observers[i].handler && (observers[i].mask & DAB_EVENT_FLAG(event->type))) {
+      observers[i].handler(observers[i].context, event);
+    }
+  }
+}
+
+/*
+ * Event from DABDUINO::poll - dispatch it or queue payload fetch
+ */
+void DABObserver::eventReceived(void *context, int8_t type, byte data[], uint8_t dataSize) {
+
+  DABObserver *self = (DABObserver *)context;
+  DABTypedEvent event;
+  memset(&event, 0, sizeof(event));
+  event.type = type;
+  if (self->prefetch & DAB_EVENT_FLAG(type)) {
+    if (self->fetching & DAB_EVENT_FLAG(type)) {
+      return; // fetch in flight reads newest payload anyway
+    }
+    byte dabCommand[7] = { 0xFE, 0x01, 0x00, 0x00, 0x00, 0x00, 0xFD };
+    switch (type) {
+    case 1: // scan finish
+      dabCommand[2] = 0x1B; // getSearchIndex
+      break;
+    case 2: // new DAB program text
+    case 6: // new FM radio text
+      dabCommand[2] = 0x10; // getProgramText
+      break;
+    case 5: // RDS group
+      dabCommand[2] = 0x32; // getRDSrawData
+      break;
+    }
+    // set before, cached answer is passed to payloadFetched inside queueCommand
+    self->fetching |= DAB_EVENT_FLAG(type);
+    if (dabCommand[2] && self->dab->queueCommand(dabCommand, payloadFetched, self, type, DAB_PRIORITY_PLAYBACK)) {
+      return;
+    }
+    self->fetching &= ~DAB_EVENT_FLAG(type);
+  }
+  if (type == 7 && dataSize) {
+    for (uint8_t i = 0; i < dataSize && i < 4; i++) {
+      event.value = (event.value << 8) + data[i];
+    }
+    event.status = 1;
+  }
+  self->dispatch(&event);
+}
+
+/*
+ * Answer of payload fetch - index is event type
+ */
+void DABObserver::payloadFetched(void *context, uint8_t index, int8_t status, byte dabData[], uint32_t dabDataSize) {
+
+  DABObserver *self = (DABObserver *)context;
+  DABTypedEvent event;
+  DABRdsGroup group;
+  memset(&event, 0, sizeof(event));
+  event.type = index;
+  self->fetching &= ~DAB_EVENT_FLAG(index);
+  if (status) {
+    switch (index) {
+    case 1:
+      event.value = dabDataSize ? dabData[0] : 0;
+      event.status = dabDataSize ? 1 : 0;
+      break;
+    case 2:
+    case 6:
+      if (self->dab->decodeProgramText(dabData, dabDataSize, self->text) != 1) {
+        return; // same text as before or no text
+      }
+      event.text = self->text;
+      event.status = 1;
+      break;
+    case 5:
+      DABDUINO::decodeRDSrawData(dabData, dabDataSize, &group);
+      if (group.status != DAB_STATUS_OK || group.state != 1) {
+        return; // no new group
+      }
+      event.rds = &group;
+      event.status = 1;
+      break;
+    }
+  }
+  self->dispatch(&event);
+}
@@ -0,0 +1,60 @@
+/*
+ * DABObserver.h - Typed event dispatch for DABDUINO library.
+ * Delivers decoded events to registered observers from poll(). Payload
+ * which the module does not send with event (program text, RDS group,
+ * search index) is fetched by queued command right when event comes, so
+ * observer gets e.g. new DLS text directly.
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef DABObserver_h
+#define DABObserver_h
+
+#include "DABDUINO.h"
+
+#define DAB_MAX_OBSERVERS 4
+// events with payload fetched by default
+#define DAB_OBSERVER_PREFETCH (DAB_EVENT_SCAN_FINISHED | DAB_EVENT_PROGRAM_TEXT | DAB_EVENT_RDS_GROUP | DAB_EVENT_FM_TEXT)
+
+struct DABTypedEvent
+{
+  int8_t type; // see DABDUINO::readEvent
+  int8_t status; // 1=payload valid, 0=payload not fetched or fetch failed
+  const char *text; // 2=new DAB program text, 6=new FM radio text
+  const DABRdsGroup *rds; // 5=RDS group
+  uint32_t value; // 1=programs found (search index), 7=scanning frequency (kHz)
+};
+
+typedef void (*DABObserverHandler)(void *context, const DABTypedEvent *event);
+
+class DABObserver
+{
+public:
+
+  DABObserver(DABDUINO& dab);
+
+  int8_t subscribe(uint16_t mask, DABObserverHandler handler, void *context);
+  void unsubscribe(DABObserverHandler handler, void *context);
+  void setPrefetch(uint16_t mask);
+  int8_t begin();
+
+private:
+  struct Observer
+  {
+    uint16_t mask;
+    DABObserverHandler handler;
+    void *context;
+  };
+
+  void dispatch(const DABTypedEvent *event);
+  static void eventReceived(void *context, int8_t type, byte data[], uint8_t dataSize);
+  static void payloadFetched(void *context, uint8_t index, int8_t status, byte dabData[], uint32_t dabDataSize);
+
+  DABDUINO *dab;
+  Observer observers[DAB_MAX_OBSERVERS];
+  uint16_t prefetch;
+  uint16_t fetching; // events with payload fetch queued
+  char text[DAB_MAX_TEXT_LENGTH];
+};
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * DABParser.cpp - Serial frame parser for DABDUINO library.
+ * @license  BSD (see license.txt)
+ */
+
+#include "DABParser.h"
+
+DABParser::DABParser() {
+
+  reset();
+}
+
+/*
+ * Forget partly received frame
+ */
+void DABParser::reset() {
+
+  index = 0;
+  dataIndex = 0;
+  size = 0;
+}
+
+/*
+ * Feed one byte from module
+ * return: true=frame complete (valid until next feed)
+ */
+boolean DABParser::feed(byte serialData) {
+
+  if (index == 0) {
+    dataIndex = 0;
+  }
+  if (serialData == 0xFE) {
+    index = 0;
+    dataIndex = 0;
+    size = 0;
+  }
+  if (size && dataIndex < size && dataIndex < DAB_FRAME_DATA_LENGTH) {
+    frame[DAB_FRAME_HEADER_LENGTH + dataIndex++] = serialData;
+  }
+  if (index < DAB_FRAME_HEADER_LENGTH) {
+    frame[index] = serialData;
+  }
+  if (index == DAB_FRAME_HEADER_LENGTH - 1) {
+    size = ((uint16_t)frame[4] << 8) + frame[5];
+  }
+  if ((int16_t)(index - size) >= DAB_FRAME_HEADER_LENGTH - 1 && serialData == 0xFD) {
+    frame[DAB_FRAME_HEADER_LENGTH + dataIndex] = 0xFD;
+    index = 0;
+    size = 0;
+    return true;
+  }
+  index++;
+  return false;
+}
+
+byte DABParser::getClass() {
+
+  return frame[1];
+}
+
+byte DABParser::getId() {
+
+  return frame[2];
+}
+
+boolean DABParser::isEvent() {
+
+  return frame[1] == 0x07;
+}
+
+boolean DABParser::isNack() {
+
+  return frame[1] == 0x00 && frame[2] == 0x02;
+}
+
+byte *DABParser::getData() {
+
+  return frame + DAB_FRAME_HEADER_LENGTH;
+}
+
+uint16_t DABParser::getDataSize() {
+
+  return dataIndex;
+}
+
+const byte *DABParser::getFrame() {
+
+  return frame;
+}
+
+uint16_t DABParser::getFrameSize() {
+
+  return DAB_FRAME_HEADER_LENGTH + dataIndex + 1;
+}
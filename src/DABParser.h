@@ -0,0 +1,61 @@
+/*
+ * DABParser.h - Serial frame parser for DABDUINO library.
+ * Splits module byte stream into frames FE class id 00 sizeHi sizeLo data FD.
+ * Has no hardware dependency, so logged serial traffic can be replayed on
+ * host (see DABLog.h, extras/frame_replay.cpp).
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef DABParser_h
+#define DABParser_h
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#else
+#include <stdint.h>
+#include <string.h>
+typedef uint8_t byte;
+typedef bool boolean;
+#endif
+
+#define DAB_FRAME_HEADER_LENGTH 6
+#define DAB_FRAME_DATA_LENGTH 256 // longer data is truncated
+
+// frame direction (see DABFrameTap)
+#define DAB_FRAME_TX 0 // command sent to module
+#define DAB_FRAME_RX 1 // bytes received from module
+
+/*
+ * Receiver of every frame sent to and all bytes received from module
+ * micros = time of frame or of last received byte (micros())
+ * frame = TX: whole frame FE..FD, RX: bytes as read from serial line (frames
+ * may be split over several calls, including noise and drained bytes)
+ */
+typedef void (*DABFrameTap)(void *context, uint8_t direction, uint32_t micros, const byte frame[], uint16_t frameSize);
+
+class DABParser
+{
+public:
+
+  DABParser();
+
+  void reset();
+  boolean feed(byte serialData);
+
+  byte getClass();
+  byte getId();
+  boolean isEvent();
+  boolean isNack();
+  byte *getData();
+  uint16_t getDataSize();
+  const byte *getFrame();
+  uint16_t getFrameSize();
+
+private:
+  byte frame[DAB_FRAME_HEADER_LENGTH + DAB_FRAME_DATA_LENGTH + 1];
+  uint16_t index; // byte of frame
+  uint16_t dataIndex; // stored data bytes
+  uint16_t size; // data size from header
+};
+
+#endif
@@ -0,0 +1,169 @@
+/*
+ * DABPower.cpp - Power saving idle mode for DABDUINO library.
+ * @license  BSD (see license.txt)
+ */
+
+#include "DABPower.h"
+#ifdef __AVR__
+#include <avr/sleep.h>
+#endif
+
+DABPower::DABPower(DABDUINO& dab) {
+
+  this->dab = &dab;
+#if defined(__AVR__) || defined(__arm__)
+  sleep = defaultSleep;
+#else
+  sleep = NULL;
+#endif
+  sleepContext = NULL;
+  burstPeriod = DAB_POWER_BURST;
+  running = false;
+  resetStats();
+}
+
+/*
+ * Set period of background work bursts (ms), see poll()
+ */
+void DABPower::setBurstPeriod(uint32_t burstPeriod) {
+
+  this->burstPeriod = burstPeriod;
+}
+
+/*
+ * Set MCU sleep function, NULL=no sleep (only measure)
+ * default: AVR idle sleep, ARM wait for interrupt (__WFI) - both wake on
+ * serial receive and timer tick; other MCU no sleep
+ */
+void DABPower::setSleep(DABSleepFunction sleep, void *context) {
+
+  this->sleep = sleep;
+  sleepContext = context;
+}
+
+/*
+ * Enter idle mode - module notifies events, application stops polling getters
+ * eventMask = events waking MCU (see DABDUINO::setEventMask)
+ * return: 1=ok, 0=error
+ */
+int8_t DABPower::begin(uint16_t eventMask) {
+
+  if (!dab->setEventMask(eventMask)) {
+    return 0;
+  }
+  running = true;
+  burstMillis = millis();
+  resetStats();
+  return 1;
+}
+
+void DABPower::end() {
+
+  running = false;
+}
+
+boolean DABPower::isIdle() {
+
+  return running;
+}
+
+/*
+ * Call at start of loop() - receives events and answers
+ * return: true=burst of background work is due (do all periodic work now,
+ * e.g. DABClock::poll, DABStations::prefetch, getPlaybackSnapshot)
+ */
+boolean DABPower::poll() {
+
+  dab->poll();
+  if (running && millis() - burstMillis >= burstPeriod) {
+    burstMillis = millis();
+    stats.bursts++;
+    return true;
+  }
+  return false;
+}
+
+/*
+ * Call at end of loop() - sleeps while module has nothing to say and no
+ * command waits; returns on event, serial data or interrupt
+ */
+void DABPower::idle() {
+
+  if (!running || !sleep) {
+    return;
+  }
+  while (!dab->isEvent() && !dab->getQueueLength() && millis() - burstMillis < burstPeriod) {
+    unsigned long startMicros = micros();
+    sleep(sleepContext);
+    sleptMicros += micros() - startMicros;
+    sleptMillis += sleptMicros / 1000;
+    sleptMicros %= 1000;
+    if (dab->isEvent()) {
+      stats.wakeups++;
+    }
+  }
+}
+
+/*
+ * Get statistics since begin() or resetStats()
+ */
+void DABPower::getStats(DABPowerStats *stats) {
+
+  this->stats.totalTime = millis() - statsMillis;
+  this->stats.awakeTime = this->stats.totalTime - sleptMillis;
+  if (this->stats.awakeTime > this->stats.totalTime) {
+    this->stats.awakeTime = this->stats.totalTime;
+  }
+  this->stats.linkTime = dab->getLinkStats()->busyTime - linkStart;
+  *stats = this->stats;
+}
+
+void DABPower::resetStats() {
+
+  memset(&stats, 0, sizeof(stats));
+  statsMillis = millis();
+  sleptMillis = 0;
+  sleptMicros = 0;
+  linkStart = dab->getLinkStats()->busyTime;
+}
+
+/*
+ * Get MCU awake time per hour in idle mode (ms)
+ */
+uint32_t DABPower::getAwakePerHour() {
+
+  DABPowerStats current;
+  getStats(&current);
+  if (!current.totalTime) {
+    return 0;
+  }
+  return (uint64_t)current.awakeTime * 3600000UL / current.totalTime;
+}
+
+/*
+ * Get share of time serial line waits for answer (per mille)
+ */
+uint16_t DABPower::getLinkDutyCycle() {
+
+  DABPowerStats current;
+  getStats(&current);
+  if (!current.totalTime) {
+    return 0;
+  }
+  return (uint64_t)current.linkTime * 1000 / current.totalTime;
+}
+
+#if defined(__AVR__)
+void DABPower::defaultSleep(void * /* context */) {
+
+  set_sleep_mode(SLEEP_MODE_IDLE);
+  sleep_enable();
+  sleep_cpu();
+  sleep_disable();
+}
+#elif defined(__arm__)
+void DABPower::defaultSleep(void * /* context */) {
+
+  __WFI();
+}
+#endif
@@ -0,0 +1,71 @@
+/*
+ * DABPower.h - Power saving idle mode for DABDUINO library.
+ * Stops periodic polling: MCU sleeps until module sends notification
+ * event or next burst of background work is due, and measures awake time
+ * and serial line activity.
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef DABPower_h
+#define DABPower_h
+
+#include "DABDUINO.h"
+
+#define DAB_POWER_BURST 5000 // default period of background work bursts (ms)
+
+/*
+ * MCU sleep, returns on any interrupt (e.g. serial receive)
+ */
+typedef void (*DABSleepFunction)(void *context);
+
+struct DABPowerStats
+{
+  uint32_t totalTime; // in idle mode (ms)
+  uint32_t awakeTime; // MCU not sleeping (ms)
+  uint32_t linkTime; // serial line waiting for answer (ms)
+  uint32_t wakeups; // by event or serial data
+  uint32_t bursts;
+};
+
+class DABPower
+{
+public:
+
+  DABPower(DABDUINO& dab);
+
+  void setBurstPeriod(uint32_t burstPeriod);
+  void setSleep(DABSleepFunction sleep, void *context);
+
+  int8_t begin(uint16_t eventMask = DAB_EVENT_ALL);
+  void end();
+  boolean isIdle();
+
+  boolean poll();
+  void idle();
+
+  void getStats(DABPowerStats *stats);
+  void resetStats();
+  uint32_t getAwakePerHour();
+  uint16_t getLinkDutyCycle();
+
+private:
+#if defined(__AVR__) || defined(__arm__)
+  static void defaultSleep(void *context);
+#endif
+
+  DABDUINO *dab;
+  DABSleepFunction sleep;
+  void *sleepContext;
+  uint32_t burstPeriod;
+  boolean running;
+  unsigned long burstMillis;
+
+  // stats
+  DABPowerStats stats;
+  unsigned long statsMillis;
+  uint32_t sleptMillis;
+  unsigned long sleptMicros; // sleep time below 1 ms
+  uint32_t linkStart; // link busy time at begin or reset
+};
+
+#endif
@@ -0,0 +1,119 @@
+/*
+ * DABPresets.cpp - Preset manager for DABDUINO library.
+ * @license  BSD (see license.txt)
+ */
+
+#include "DABPresets.h"
+
+DABPresets::DABPresets(DABDUINO& dab, DABStations *stations) {
+
+  this->dab = &dab;
+  this->stations = stations;
+  memset(presets, 0, sizeof(presets));
+  dirty = 0;
+}
+
+/*
+ * Load all preset slots from module in one pipelined batch
+ * return: 1=all slots loaded, 0=error
+ */
+int8_t DABPresets::load() {
+
+  byte dabCommands[2 * DAB_PRESETS][9];
+  byte *commands[2 * DAB_PRESETS];
+  for (uint8_t i = 0; i < 2 * DAB_PRESETS; i++) {
+    byte dabCommand[9] = { 0xFE, 0x01, 0x22, 0x00, 0x00, 0x02, (byte)(i / DAB_PRESETS), (byte)(i % DAB_PRESETS), 0xFD };
+    memcpy(dabCommands[i], dabCommand, sizeof(dabCommand));
+    commands[i] = dabCommands[i];
+  }
+  // loaded slots are clean, slots not loaded keep unsynced changes
+  return (dab->sendCommands(commands, 2 * DAB_PRESETS, response, this) == 2 * DAB_PRESETS) ? 1 : 0;
+}
+
+/*
+ * Write changed slots to module
+ * return: 1=all changed slots written, 0=error
+ */
+int8_t DABPresets::sync() {
+
+  byte dabCommands[2 * DAB_PRESETS][13];
+  byte *commands[2 * DAB_PRESETS];
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < 2 * DAB_PRESETS; i++) {
+    if (!(dirty & (1UL << i))) continue;
+    uint32_t value = presets[i / DAB_PRESETS][i % DAB_PRESETS];
+    byte dabCommand[13] = { 0xFE, 0x01, 0x21, 0x00, 0x00, 0x06, (byte)(i / DAB_PRESETS), (byte)(i % DAB_PRESETS), (byte)(value >> 24), (byte)(value >> 16), (byte)(value >> 8), (byte)value, 0xFD };
+    memcpy(dabCommands[count], dabCommand, sizeof(dabCommand));
+    commands[count] = dabCommands[count];
+    count++;
+  }
+  if (!count) return 1;
+  if (dab->sendCommands(commands, count, NULL, NULL) != count) {
+    return 0;
+  }
+  dirty = 0;
+  return 1;
+}
+
+/*
+ * Get preset
+ * return: DAB: programIndex, FM: frequency
+ */
+uint32_t DABPresets::get(uint8_t presetIndex, uint8_t presetMode) {
+
+  if (presetIndex >= DAB_PRESETS || presetMode > DAB_PRESET_FM) return 0;
+  return presets[presetMode][presetIndex];
+}
+
+/*
+ * Set preset in RAM, write it to module with sync()
+ * programIndex = DAB: programIndex, FM: frequency
+ */
+void DABPresets::set(uint8_t presetIndex, uint8_t presetMode, uint32_t programIndex) {
+
+  if (presetIndex >= DAB_PRESETS || presetMode > DAB_PRESET_FM) return;
+  if (presets[presetMode][presetIndex] != programIndex) {
+    presets[presetMode][presetIndex] = programIndex;
+    dirty |= (1UL << (presetMode * DAB_PRESETS + presetIndex));
+  }
+}
+
+/*
+ * Test some preset is not written to module yet
+ */
+boolean DABPresets::isDirty() {
+
+  return dirty != 0;
+}
+
+/*
+ * Get cached station of DAB preset
+ * return: NULL=no station cache or program is not in cache
+ */
+const DABStation *DABPresets::getStation(uint8_t presetIndex) {
+
+  if (!stations || presetIndex >= DAB_PRESETS) return NULL;
+  return stations->getStation(presets[DAB_PRESET_DAB][presetIndex]);
+}
+
+/*
+ * Play preset (see DABDUINO::tune), no lookup in module
+ * Station name for display is in getStation().
+ */
+int8_t DABPresets::play(uint8_t presetIndex, uint8_t presetMode) {
+
+  if (presetIndex >= DAB_PRESETS || presetMode > DAB_PRESET_FM) return 0;
+  return dab->tune(presetMode, presets[presetMode][presetIndex]);
+}
+
+/*
+ * Answer of pipelined getPreset
+ */
+void DABPresets::response(void *context, uint8_t index, int8_t status, byte dabData[], uint32_t dabDataSize) {
+
+  DABPresets *self = (DABPresets *)context;
+  if (status && dabDataSize >= 4) {
+    self->presets[index / DAB_PRESETS][index % DAB_PRESETS] = (((uint32_t)dabData[0] << 24) + ((uint32_t)dabData[1] << 16) + ((uint32_t)dabData[2] << 8) + (uint32_t)dabData[3]);
+    self->dirty &= ~(1UL << index);
+  }
+}
@@ -0,0 +1,45 @@
+/*
+ * DABPresets.h - Preset manager for DABDUINO library.
+ * Mirrors all DAB and FM preset slots in RAM, loads them in one pipelined
+ * batch and writes back only changed slots.
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef DABPresets_h
+#define DABPresets_h
+
+#include "DABDUINO.h"
+#include "DABStations.h"
+
+#define DAB_PRESETS 10 // presetIndex 0..9
+
+// preset modes
+#define DAB_PRESET_DAB 0
+#define DAB_PRESET_FM 1
+
+class DABPresets
+{
+public:
+
+  DABPresets(DABDUINO& dab, DABStations *stations);
+
+  int8_t load();
+  int8_t sync();
+
+  uint32_t get(uint8_t presetIndex, uint8_t presetMode);
+  void set(uint8_t presetIndex, uint8_t presetMode, uint32_t programIndex);
+  boolean isDirty();
+
+  const DABStation *getStation(uint8_t presetIndex);
+  int8_t play(uint8_t presetIndex, uint8_t presetMode);
+
+private:
+  static void response(void *context, uint8_t index, int8_t status, byte dabData[], uint32_t dabDataSize);
+
+  DABDUINO *dab;
+  DABStations *stations;
+  uint32_t presets[2][DAB_PRESETS]; // DAB: programIndex, FM: frequency
+  uint32_t dirty; // bit = presetMode * DAB_PRESETS + presetIndex
+};
+
+#endif
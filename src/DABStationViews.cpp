@@ -0,0 +1,273 @@
+/*
+ * DABStationViews.cpp - Sorted and filtered station lists for DABDUINO library.
+ * @license  BSD (see license.txt)
+ */
+
+#include "DABStationViews.h"
+
+DABStationViews::DABStationViews(DABStations *stations) {
+
+  this->stations = stations;
+  viewCount = 0;
+  remapPending = false;
+}
+
+/*
+ * Add view and build it from loaded stations
+ * order = DAB_VIEW_PROGRAM, DAB_VIEW_NAME, DAB_VIEW_ENSEMBLE, DAB_VIEW_TYPE
+ * filter = 0=all stations, DAB_VIEW_ON_AIR, DAB_VIEW_BAND_3, DAB_VIEW_CHINA_BAND, DAB_VIEW_L_BAND
+ * return: view, -1=no free view
+ */
+int8_t DABStationViews::addView(uint8_t order, uint8_t filter) {
+
+  if (viewCount == DAB_MAX_VIEWS) return -1;
+  DABStationView *view = &views[viewCount];
+  view->order = order;
+  view->filter = filter;
+  view->count = 0;
+  for (uint16_t program = 0; program < stations->getCount(); program++) {
+    insert(view, program);
+  }
+  return viewCount++;
+}
+
+/*
+ * Build all views again, call after DABStations::load
+ */
+void DABStationViews::build() {
+
+  remapPending = false;
+  for (uint8_t i = 0; i < viewCount; i++) {
+    views[i].count = 0;
+    for (uint16_t program = 0; program < stations->getCount(); program++) {
+      insert(&views[i], program);
+    }
+  }
+}
+
+/*
+ * Sort station into views again after its fields changed (loadStation,
+ * prefetch, on-air status reloaded)
+ */
+void DABStationViews::refresh(uint32_t programIndex) {
+
+  applyRemap();
+  if (programIndex >= stations->getCount()) return;
+  for (uint8_t i = 0; i < viewCount; i++) {
+    remove(&views[i], programIndex);
+    insert(&views[i], programIndex);
+  }
+}
+
+/*
+ * Handler for DABStations::update, context = DABStationViews.
+ * Removed and moved stations keep their sort position, only program indexes
+ * are renumbered; added stations are sorted in.
+ */
+void DABStationViews::change(void *context, uint8_t change, uint16_t programIndex, uint16_t oldIndex, const DABStation * /* station */) {
+
+  DABStationViews *self = (DABStationViews *)context;
+  if ((change == DAB_STATION_REMOVED || change == DAB_STATION_MOVED) && !self->remapPending) {
+    for (uint8_t i = 0; i < DAB_MAX_STATIONS; i++) {
+      self->remap[i] = i;
+    }
+    self->remapPending = true;
+  }
+  switch (change) {
+  case DAB_STATION_REMOVED:
+    self->remap[programIndex] = 0xFF;
+    break;
+  case DAB_STATION_MOVED:
+    self->remap[oldIndex] = programIndex;
+    break;
+  case DAB_STATION_ADDED:
+    self->applyRemap();
+    for (uint8_t i = 0; i < self->viewCount; i++) {
+      self->insert(&self->views[i], programIndex);
+    }
+    break;
+  case DAB_STATION_UPDATED:
+    self->applyRemap();
+    break;
+  }
+}
+
+uint8_t DABStationViews::getCount(uint8_t view) {
+
+  applyRemap();
+  return (view < viewCount) ? views[view].count : 0;
+}
+
+/*
+ * Get program indexes of view in view order
+ * return: NULL=no view
+ */
+const uint8_t *DABStationViews::getPrograms(uint8_t view, uint8_t *count) {
+
+  applyRemap();
+  if (view >= viewCount) {
+    *count = 0;
+    return NULL;
+  }
+  *count = views[view].count;
+  return views[view].programs;
+}
+
+/*
+ * Get program index at position of view
+ * return: program index, -1=no station
+ */
+int16_t DABStationViews::getProgram(uint8_t view, uint8_t position) {
+
+  applyRemap();
+  if (view >= viewCount || position >= views[view].count) return -1;
+  return views[view].programs[position];
+}
+
+/*
+ * Find position of program in view (UI cursor after view switch)
+ * return: position, -1=not in view
+ */
+int16_t DABStationViews::findPosition(uint8_t view, uint32_t programIndex) {
+
+  applyRemap();
+  if (view >= viewCount) return -1;
+  for (uint8_t i = 0; i < views[view].count; i++) {
+    if (views[view].programs[i] == programIndex) return i;
+  }
+  return -1;
+}
+
+/*
+ * Check filter of view, stations without loaded filter field are left out
+ */
+boolean DABStationViews::accept(DABStationView *view, uint16_t program) {
+
+  DABStation *station = stations->getStation(program);
+  if (!station) return false;
+  if ((view->filter & DAB_VIEW_ON_AIR) && (!(station->valid & DAB_STATION_ON_AIR) || !station->onAir)) {
+    return false;
+  }
+  uint8_t bands = view->filter & (DAB_VIEW_BAND_3 | DAB_VIEW_CHINA_BAND | DAB_VIEW_L_BAND);
+  if (bands) {
+    if (!(station->valid & DAB_STATION_FREQUENCY)) return false;
+    switch (DABChannels::getBand(station->frequencyIndex)) {
+    case DAB_BAND_3: return bands & DAB_VIEW_BAND_3;
+    case DAB_CHINA_BAND: return bands & DAB_VIEW_CHINA_BAND;
+    case DAB_L_BAND: return bands & DAB_VIEW_L_BAND;
+    default: return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Compact sort key: primary field and first name characters (upper case)
+ * packed big endian, so most comparisons are one integer compare
+ */
+uint32_t DABStationViews::sortKey(uint8_t order, uint16_t program) {
+
+  DABStation *station = stations->getStation(program);
+  uint32_t key = 0;
+  uint8_t chars = 4;
+  if (order == DAB_VIEW_ENSEMBLE) {
+    key = (station->valid & DAB_STATION_INFO) ? station->ensembleId : 0;
+    chars = 2;
+  } else if (order == DAB_VIEW_TYPE) {
+    key = (station->valid & DAB_STATION_TYPE) ? station->serviceType : 0;
+    chars = 3;
+  }
+  const char *name = (station->valid & DAB_STATION_NAME) ? station->name : "";
+  for (uint8_t i = 0; i < chars; i++) {
+    char c = *name;
+    if (c) name++;
+    key = (key << 8) | (uint8_t)((c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c);
+  }
+  return key;
+}
+
+/*
+ * Compare program (with its sort key) to other program of view
+ * return: <0=program first, >0=other first
+ */
+int8_t DABStationViews::compare(uint8_t order, uint16_t program, uint32_t key, uint16_t other) {
+
+  if (order != DAB_VIEW_PROGRAM) {
+    uint32_t otherKey = sortKey(order, other);
+    if (key != otherKey) return (key < otherKey) ? -1 : 1;
+    DABStation *station = stations->getStation(program);
+    DABStation *otherStation = stations->getStation(other);
+    int result = strcasecmp((station->valid & DAB_STATION_NAME) ? station->name : "", (otherStation->valid & DAB_STATION_NAME) ? otherStation->name : "");
+    if (result) return (result < 0) ? -1 : 1;
+    // equal names: stable key, so renumbering by update keeps order
+    if (station->valid & otherStation->valid & DAB_STATION_INFO) {
+      if (station->ensembleId != otherStation->ensembleId) return (station->ensembleId < otherStation->ensembleId) ? -1 : 1;
+      if (station->serviceId != otherStation->serviceId) return (station->serviceId < otherStation->serviceId) ? -1 : 1;
+    }
+  }
+  return (program < other) ? -1 : 1;
+}
+
+/*
+ * Sort program into view (binary search), if filter accepts it
+ */
+void DABStationViews::insert(DABStationView *view, uint16_t program) {
+
+  if (!accept(view, program)) return;
+  uint32_t key = (view->order != DAB_VIEW_PROGRAM) ? sortKey(view->order, program) : 0;
+  uint8_t low = 0;
+  uint8_t high = view->count;
+  while (low < high) {
+    uint8_t middle = (low + high) / 2;
+    if (compare(view->order, program, key, view->programs[middle]) > 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  memmove(&view->programs[low + 1], &view->programs[low], view->count - low);
+  view->programs[low] = program;
+  view->count++;
+}
+
+void DABStationViews::remove(DABStationView *view, uint16_t program) {
+
+  for (uint8_t i = 0; i < view->count; i++) {
+    if (view->programs[i] == program) {
+      view->count--;
+      memmove(&view->programs[i], &view->programs[i + 1], view->count - i);
+      return;
+    }
+  }
+}
+
+/*
+ * Renumber program indexes after update, order of kept stations is unchanged
+ * (program order views are filtered again)
+ */
+void DABStationViews::applyRemap() {
+
+  if (!remapPending) return;
+  remapPending = false;
+  for (uint8_t i = 0; i < viewCount; i++) {
+    DABStationView *view = &views[i];
+    uint8_t count = 0;
+    if (view->order == DAB_VIEW_PROGRAM) {
+      uint8_t kept[DAB_MAX_STATIONS];
+      memset(kept, 0, sizeof(kept));
+      for (uint8_t j = 0; j < view->count; j++) {
+        if (remap[view->programs[j]] != 0xFF) kept[remap[view->programs[j]]] = 1;
+      }
+      for (uint16_t program = 0; program < stations->getCount(); program++) {
+        if (kept[program]) view->programs[count++] = program;
+      }
+      view->count = count;
+      continue;
+    }
+    for (uint8_t j = 0; j < view->count; j++) {
+      uint8_t program = remap[view->programs[j]];
+      if (program != 0xFF) view->programs[count++] = program;
+    }
+    view->count = count;
+  }
+}
@@ -0,0 +1,69 @@
+/*
+ * DABStationViews.h - Sorted and filtered station lists for DABDUINO library.
+ * Keeps program index lists over station cache (see DABStations), sorted by
+ * name, ensemble or service type and filtered by on-air status and band, so
+ * UI switches list order without module round trip or sorting in sketch.
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef DABStationViews_h
+#define DABStationViews_h
+
+#include "DABDUINO.h"
+#include "DABStations.h"
+#include "DABChannels.h"
+
+#define DAB_MAX_VIEWS 4
+
+// view orders
+#define DAB_VIEW_PROGRAM 0 // module program order
+#define DAB_VIEW_NAME 1 // service name
+#define DAB_VIEW_ENSEMBLE 2 // ensemble id, then service name
+#define DAB_VIEW_TYPE 3 // service type, then service name
+
+// view filters, no band flag = all bands
+#define DAB_VIEW_ON_AIR 0x01 // only stations on air (load DAB_STATION_ON_AIR)
+#define DAB_VIEW_BAND_3 0x02 // load DAB_STATION_FREQUENCY for band filters
+#define DAB_VIEW_CHINA_BAND 0x04
+#define DAB_VIEW_L_BAND 0x08
+
+struct DABStationView
+{
+  uint8_t order;
+  uint8_t filter;
+  uint8_t count;
+  uint8_t programs[DAB_MAX_STATIONS];
+};
+
+class DABStationViews
+{
+public:
+
+  DABStationViews(DABStations *stations);
+
+  int8_t addView(uint8_t order, uint8_t filter);
+  void build();
+  void refresh(uint32_t programIndex);
+  static void change(void *context, uint8_t change, uint16_t programIndex, uint16_t oldIndex, const DABStation *station);
+
+  uint8_t getCount(uint8_t view);
+  const uint8_t *getPrograms(uint8_t view, uint8_t *count);
+  int16_t getProgram(uint8_t view, uint8_t position);
+  int16_t findPosition(uint8_t view, uint32_t programIndex);
+
+private:
+  boolean accept(DABStationView *view, uint16_t program);
+  uint32_t sortKey(uint8_t order, uint16_t program);
+  int8_t compare(uint8_t order, uint16_t program, uint32_t key, uint16_t other);
+  void insert(DABStationView *view, uint16_t program);
+  void remove(DABStationView *view, uint16_t program);
+  void applyRemap();
+
+  DABStations *stations;
+  DABStationView views[DAB_MAX_VIEWS];
+  uint8_t viewCount;
+  uint8_t remap[DAB_MAX_STATIONS]; // new program index of old, 0xFF=removed
+  boolean remapPending;
+};
+
+#endif
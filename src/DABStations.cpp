@@ -0,0 +1,483 @@
+/*
+ * DABStations.cpp - DAB station cache for DABDUINO library.
+ * @license  BSD (see license.txt)
+ */
+
+#include "DABStations.h"
+
+DABStations::DABStations(DABDUINO& dab) {
+
+  this->dab = &dab;
+  cursor = 0;
+  prefetchPending = false;
+  memset(&updateStats, 0, sizeof(updateStats));
+  clear();
+}
+
+/*
+ * Forget all stations
+ */
+void DABStations::clear() {
+
+  count = 0;
+  memset(keys, 0, sizeof(keys));
+}
+
+/*
+ * Load all stations from module database (after searchDAB)
+ * fields = 0=only number of stations (fields are loaded by prefetch), DAB_STATION_NAME, DAB_STATION_INFO, DAB_STATION_FREQUENCY, DAB_STATION_TYPE, DAB_STATION_ON_AIR, DAB_STATION_ALL (without ON_AIR)
+ * return: 1=all fields loaded, 0=error
+ */
+int8_t DABStations::load(uint8_t fields) {
+
+  uint32_t programs;
+  if (!dab->getProgramIndex(&programs)) {
+    return 0;
+  }
+  count = (programs < DAB_MAX_STATIONS) ? programs : DAB_MAX_STATIONS;
+  for (uint16_t i = 0; i < count; i++) {
+    stations[i].valid = 0;
+  }
+  memset(keys, 0, sizeof(keys));
+  return count ? fetch(0, count - 1, fields) : 1;
+}
+
+/*
+ * Load missing fields of one station
+ * return: 1=fields loaded, 0=error
+ */
+int8_t DABStations::loadStation(uint32_t programIndex, uint8_t fields) {
+
+  if (programIndex >= count) return 0;
+  return fetch(programIndex, programIndex, fields);
+}
+
+/*
+ * Update stations after DAB reconfiguration (event 3) or channel list order
+ * change (event 4). Service and ensemble ids of module list are compared
+ * with cached stations: known services keep their loaded fields (moved when
+ * program index changed), only new services and DAB_STATION_VOLATILE fields
+ * of known services are fetched, in one pipelined pass.
+ * fields = fields to load for new stations (see load)
+ * handler = called for every removed, moved and added station (in this order)
+ *   and once at end, NULL=none
+ * return: 1=ok, 0=error (cache unchanged when ids could not be read)
+ */
+int8_t DABStations::update(uint8_t fields, DABStationsHandler handler, void *context) {
+
+  uint32_t startCommands = dab->getLinkStats()->exchanges;
+  uint32_t programs;
+  if (!dab->getProgramIndex(&programs)) {
+    return 0;
+  }
+  uint16_t newCount = (programs < DAB_MAX_STATIONS) ? programs : DAB_MAX_STATIONS;
+  uint16_t oldCount = count;
+  uint32_t serviceIds[DAB_MAX_STATIONS];
+  uint16_t ensembleIds[DAB_MAX_STATIONS];
+  uint8_t found[DAB_MAX_STATIONS];
+  uint8_t oldOf[DAB_MAX_STATIONS]; // old index of new station, 0xFF=new
+  uint8_t target[DAB_MAX_STATIONS]; // new index of old station, 0xFF=removed
+  memset(&updateStats, 0, sizeof(updateStats));
+  memset(found, 0, sizeof(found));
+
+  // ids of module list, pipelined
+  byte dabCommands[DAB_STATIONS_BATCH][12];
+  byte *commands[DAB_STATIONS_BATCH];
+  updateServiceIds = serviceIds;
+  updateEnsembleIds = ensembleIds;
+  updateFound = found;
+  for (uint16_t first = 0; first < newCount; first += DAB_STATIONS_BATCH) {
+    uint8_t batch = 0;
+    for (uint16_t program = first; program < newCount && batch < DAB_STATIONS_BATCH; program++) {
+      buildCommand(dabCommands[batch], program, DAB_STATION_INFO);
+      commands[batch] = dabCommands[batch];
+      batchProgram[batch++] = program;
+    }
+    if (dab->sendCommands(commands, batch, infoResponse, this) != batch) {
+      // unread ids would look like removed services, keep cache as it is
+      updateStats.commands = dab->getLinkStats()->exchanges - startCommands;
+      return 0;
+    }
+  }
+
+  // match by ids, keep order of duplicates
+  memset(target, 0xFF, sizeof(target));
+  for (uint16_t i = 0; i < newCount; i++) {
+    oldOf[i] = 0xFF;
+    if (!found[i]) continue;
+    for (uint16_t j = 0; j < oldCount; j++) {
+      if (target[j] == 0xFF && (stations[j].valid & DAB_STATION_INFO) && stations[j].serviceId == serviceIds[i] && stations[j].ensembleId == ensembleIds[i]) {
+        oldOf[i] = j;
+        target[j] = i;
+        break;
+      }
+    }
+  }
+  for (uint16_t j = 0; j < oldCount; j++) {
+    if (target[j] == 0xFF) {
+      updateStats.removed++;
+      if (handler) handler(context, DAB_STATION_REMOVED, j, j, &stations[j]);
+    }
+  }
+  if (prefetchPending) {
+    // answer of queued prefetch goes to station at its new index
+    prefetchProgram = (prefetchProgram < oldCount && target[prefetchProgram] != 0xFF) ? target[prefetchProgram] : 0xFFFF;
+  }
+  move(target, oldCount);
+  count = newCount;
+  for (uint16_t i = 0; i < newCount; i++) {
+    if (oldOf[i] == 0xFF) {
+      memset(&stations[i], 0, sizeof(DABStation));
+      if (found[i]) {
+        stations[i].serviceId = serviceIds[i];
+        stations[i].ensembleId = ensembleIds[i];
+        stations[i].valid = DAB_STATION_INFO;
+      }
+      updateStats.added++;
+    } else if (oldOf[i] != i) {
+      updateStats.moved++;
+      if (handler) handler(context, DAB_STATION_MOVED, i, oldOf[i], &stations[i]);
+    }
+  }
+  // keys of new program indexes, first program index of duplicate service wins
+  memset(keys, 0, sizeof(keys));
+  for (uint16_t i = 0; i < newCount; i++) {
+    if (stations[i].valid & DAB_STATION_INFO) keyInsert(i);
+  }
+
+  // fields of new stations, name and on air status of known service may have changed
+  uint8_t programFields[DAB_MAX_STATIONS];
+  for (uint16_t i = 0; i < newCount; i++) {
+    if (oldOf[i] == 0xFF) {
+      programFields[i] = fields;
+    } else {
+      programFields[i] = (stations[i].valid | fields) & DAB_STATION_VOLATILE;
+      stations[i].valid &= ~DAB_STATION_VOLATILE;
+    }
+  }
+  int8_t result = newCount ? fetch(0, newCount - 1, 0, programFields) : 1;
+  for (uint16_t i = 0; i < newCount; i++) {
+    if (oldOf[i] == 0xFF) {
+      if (handler) handler(context, DAB_STATION_ADDED, i, i, &stations[i]);
+    }
+  }
+  if (handler) handler(context, DAB_STATION_UPDATED, count, count, NULL);
+
+  uint8_t fieldCount = 0;
+  for (uint8_t field = 0x01; field & DAB_STATION_FIELDS; field <<= 1) {
+    if (fields & field) fieldCount++;
+  }
+  updateStats.commands = dab->getLinkStats()->exchanges - startCommands;
+  updateStats.fullCommands = 1 + (uint32_t)newCount * fieldCount;
+  return result;
+}
+
+/*
+ * Get statistics of last update - commands sent against full reload
+ */
+const DABUpdateStats *DABStations::getUpdateStats() {
+
+  return &updateStats;
+}
+
+/*
+ * Move old stations to new program indexes (cycles of permutation), stations
+ * at removed indexes are dropped
+ */
+void DABStations::move(uint8_t target[], uint16_t oldCount) {
+
+  DABStation carry;
+  DABStation displaced;
+  for (uint16_t j = 0; j < oldCount; j++) {
+    if (target[j] == 0xFF || target[j] == j) continue;
+    carry = stations[j];
+    uint8_t next = target[j];
+    target[j] = 0xFF;
+    while (true) {
+      uint8_t nextTarget = (next < oldCount) ? target[next] : 0xFF;
+      displaced = stations[next];
+      stations[next] = carry;
+      if (nextTarget == 0xFF) break;
+      target[next] = 0xFF;
+      carry = displaced;
+      next = nextTarget;
+    }
+  }
+}
+
+/*
+ * Get number of stations
+ */
+uint16_t DABStations::getCount() {
+
+  return count;
+}
+
+/*
+ * Get station, check valid for loaded fields
+ * return: NULL=no station
+ */
+DABStation *DABStations::getStation(uint32_t programIndex) {
+
+  if (programIndex >= count) return NULL;
+  return &stations[programIndex];
+}
+
+/*
+ * Find program index of service (stations with loaded DAB_STATION_INFO)
+ * return: program index, -1=not found
+ */
+int16_t DABStations::findService(uint32_t serviceId, uint16_t ensembleId) {
+
+  for (uint8_t slot = keyHash(serviceId, ensembleId); keys[slot]; slot = (slot + 1) & (DAB_STATION_KEYS - 1)) {
+    DABStation *station = &stations[keys[slot] - 1];
+    if (station->serviceId == serviceId && station->ensembleId == ensembleId) {
+      return keys[slot] - 1;
+    }
+  }
+  return -1;
+}
+
+/*
+ * Get stable key of station, store it instead of program index (presets, UI selection)
+ * return: 1=ok, 0=no station or DAB_STATION_INFO not loaded
+ */
+int8_t DABStations::getKey(uint32_t programIndex, DABStationKey *key) {
+
+  if (programIndex >= count || !(stations[programIndex].valid & DAB_STATION_INFO)) return 0;
+  key->serviceId = stations[programIndex].serviceId;
+  key->ensembleId = stations[programIndex].ensembleId;
+  return 1;
+}
+
+/*
+ * Find current program index of station key
+ * return: program index, -1=not found
+ */
+int16_t DABStations::findKey(const DABStationKey *key) {
+
+  return findService(key->serviceId, key->ensembleId);
+}
+
+/*
+ * Slot of key in key table
+ */
+uint8_t DABStations::keyHash(uint32_t serviceId, uint16_t ensembleId) {
+
+  uint16_t hash = (uint16_t)serviceId ^ (uint16_t)(serviceId >> 16) ^ ensembleId;
+  hash ^= hash >> 8;
+  return hash & (DAB_STATION_KEYS - 1);
+}
+
+/*
+ * Add key of station to key table (first program index of duplicate service wins)
+ */
+void DABStations::keyInsert(uint16_t program) {
+
+  uint8_t slot = keyHash(stations[program].serviceId, stations[program].ensembleId);
+  while (keys[slot]) {
+    DABStation *station = &stations[keys[slot] - 1];
+    if (station->serviceId == stations[program].serviceId && station->ensembleId == stations[program].ensembleId) return;
+    slot = (slot + 1) & (DAB_STATION_KEYS - 1);
+  }
+  keys[slot] = program + 1;
+}
+
+/*
+ * Remove key of station from key table, following keys are shifted back
+ * into the free slot (linear probing without tombstones). Duplicate service
+ * at other program index takes the key over.
+ */
+void DABStations::keyRemove(uint16_t program) {
+
+  uint8_t slot = keyHash(stations[program].serviceId, stations[program].ensembleId);
+  while (keys[slot] && keys[slot] != program + 1) {
+    slot = (slot + 1) & (DAB_STATION_KEYS - 1);
+  }
+  if (!keys[slot]) return;
+  keys[slot] = 0;
+  for (uint8_t next = (slot + 1) & (DAB_STATION_KEYS - 1); keys[next]; next = (next + 1) & (DAB_STATION_KEYS - 1)) {
+    DABStation *station = &stations[keys[next] - 1];
+    uint8_t home = keyHash(station->serviceId, station->ensembleId);
+    // move back unless home lies cyclically in (slot, next]
+    if (((next - home) & (DAB_STATION_KEYS - 1)) >= ((next - slot) & (DAB_STATION_KEYS - 1))) {
+      keys[slot] = keys[next];
+      keys[next] = 0;
+      slot = next;
+    }
+  }
+  for (uint16_t j = 0; j < count; j++) {
+    if (j != program && (stations[j].valid & DAB_STATION_INFO) && stations[j].serviceId == stations[program].serviceId
+        && stations[j].ensembleId == stations[program].ensembleId) {
+      keyInsert(j);
+      break;
+    }
+  }
+}
+
+/*
+ * Fetch missing fields of stations with pipelined commands
+ * programFields = fields by program instead of fields, NULL=same fields for all
+ */
+uint8_t DABStations::fetch(uint16_t firstProgram, uint16_t lastProgram, uint8_t fields, const uint8_t programFields[]) {
+
+  byte dabCommands[DAB_STATIONS_BATCH][12];
+  byte *commands[DAB_STATIONS_BATCH];
+  uint8_t batch = 0;
+  uint8_t result = 1;
+  for (uint16_t program = firstProgram; program <= lastProgram; program++) {
+    if (programFields) fields = programFields[program];
+    for (uint8_t field = 0x01; field & DAB_STATION_FIELDS; field <<= 1) {
+      if (!(fields & field) || (stations[program].valid & field)) continue;
+      buildCommand(dabCommands[batch], program, field);
+      commands[batch] = dabCommands[batch];
+      batchProgram[batch] = program;
+      batchField[batch] = field;
+      batch++;
+      if (batch == DAB_STATIONS_BATCH) {
+        if (dab->sendCommands(commands, batch, response, this) != batch) result = 0;
+        batch = 0;
+      }
+    }
+  }
+  if (batch) {
+    if (dab->sendCommands(commands, batch, response, this) != batch) result = 0;
+  }
+  return result;
+}
+
+/*
+ * Set cursor of UI station list, prefetch() loads stations around it
+ */
+void DABStations::setCursor(uint32_t programIndex) {
+
+  cursor = programIndex;
+}
+
+/*
+ * Prefetch fields of stations around cursor while serial line is idle.
+ * Only one command is queued at a time, so user commands wait at most one
+ * short answer. Call it from loop() after DABDUINO::poll().
+ * fields = fields to prefetch (see load)
+ * return: 1=command queued, 0=nothing to do or line is busy
+ */
+int8_t DABStations::prefetch(uint8_t fields) {
+
+  if (prefetchPending || dab->getLinkIdleTime() < DAB_PREFETCH_IDLE) {
+    return 0;
+  }
+  // nearest neighbour first: cursor, +1, -1, +2, -2...
+  for (uint8_t distance = 0; distance <= 2 * DAB_PREFETCH_RANGE; distance++) {
+    int32_t program = (int32_t)cursor + ((distance & 0x01) ? (distance + 1) / 2 : -(distance / 2));
+    if (program < 0 || program >= count) continue;
+    uint8_t missing = fields & ~stations[program].valid & DAB_STATION_FIELDS;
+    if (!missing) continue;
+    uint8_t field = missing & -missing; // lowest missing field
+    byte dabCommand[12];
+    buildCommand(dabCommand, program, field);
+    if (dab->queueCommand(dabCommand, prefetchResponse, this, 0, DAB_PRIORITY_BACKGROUND)) {
+      prefetchProgram = program;
+      prefetchField = field;
+      prefetchPending = true;
+      return 1;
+    }
+    return 0;
+  }
+  return 0;
+}
+
+/*
+ * Build command for station field
+ */
+void DABStations::buildCommand(byte dabCommand[], uint16_t program, uint8_t field) {
+
+  byte id;
+  switch (field) {
+  case DAB_STATION_NAME: id = 0x1A; break; // service long name
+  case DAB_STATION_INFO: id = 0x23; break;
+  case DAB_STATION_FREQUENCY: id = 0x14; break;
+  case DAB_STATION_ON_AIR: id = 0x17; break;
+  default: id = 0x1E; break; // service component type
+  }
+  byte command[12] = { 0xFE, 0x01, id, 0x00, 0x00, 0x04, 0x00, 0x00, (byte)(program >> 8), (byte)program, 0xFD, 0x00 };
+  if (field == DAB_STATION_NAME) {
+    command[5] = 0x05;
+    command[10] = 0x01; // long name
+    command[11] = 0xFD;
+  }
+  memcpy(dabCommand, command, sizeof(command));
+}
+
+/*
+ * Answer of pipelined command
+ */
+void DABStations::response(void *context, uint8_t index, int8_t status, byte dabData[], uint32_t dabDataSize) {
+
+  DABStations *self = (DABStations *)context;
+  if (status) {
+    self->store(self->batchProgram[index], self->batchField[index], dabData, dabDataSize);
+  }
+}
+
+/*
+ * Answer of prefetch command
+ */
+void DABStations::prefetchResponse(void *context, uint8_t /* index */, int8_t status, byte dabData[], uint32_t dabDataSize) {
+
+  DABStations *self = (DABStations *)context;
+  self->prefetchPending = false;
+  if (status && self->prefetchProgram < self->count) {
+    self->store(self->prefetchProgram, self->prefetchField, dabData, dabDataSize);
+  }
+}
+
+/*
+ * Answer of id command of update
+ */
+void DABStations::infoResponse(void *context, uint8_t index, int8_t status, byte dabData[], uint32_t dabDataSize) {
+
+  DABStations *self = (DABStations *)context;
+  uint16_t program = self->batchProgram[index];
+  if (status && dabDataSize >= 6) {
+    self->updateServiceIds[program] = (((uint32_t)dabData[0] << 24) + ((uint32_t)dabData[1] << 16) + ((uint32_t)dabData[2] << 8) + (uint32_t)dabData[3]);
+    self->updateEnsembleIds[program] = ((uint16_t)dabData[4] << 8) + dabData[5];
+    self->updateFound[program] = 1;
+  }
+}
+
+/*
+ * Store field of station from module answer
+ */
+void DABStations::store(uint16_t program, uint8_t field, byte dabData[], uint32_t dabDataSize) {
+
+  DABStation *station = &stations[program];
+  if (!dabDataSize) return;
+  switch (field) {
+  case DAB_STATION_NAME: {
+    uint8_t j = 0;
+    for (uint32_t i = 0; i + 1 < dabDataSize && j < DAB_STATION_NAME_LENGTH; i = i + 2) {
+      station->name[j++] = (char)dab->charToAscii(dabData[i], dabData[i + 1]);
+    }
+    while (j && station->name[j - 1] == ' ') j--;
+    station->name[j] = 0x00;
+    break;
+  }
+  case DAB_STATION_INFO:
+    if (dabDataSize < 6) return;
+    if (station->valid & DAB_STATION_INFO) keyRemove(program);
+    station->serviceId = (((uint32_t)dabData[0] << 24) + ((uint32_t)dabData[1] << 16) + ((uint32_t)dabData[2] << 8) + (uint32_t)dabData[3]);
+    station->ensembleId = ((uint16_t)dabData[4] << 8) + dabData[5];
+    keyInsert(program);
+    break;
+  case DAB_STATION_FREQUENCY:
+    station->frequencyIndex = dabData[0];
+    break;
+  case DAB_STATION_TYPE:
+    station->serviceType = dabData[0];
+    break;
+  case DAB_STATION_ON_AIR:
+    station->onAir = dabData[0];
+    break;
+  }
+  station->valid |= field;
+}
@@ -0,0 +1,136 @@
+/*
+ * DABStations.h - DAB station cache for DABDUINO library.
+ * Mirrors module program database (name, service/ensemble id, frequency,
+ * service type) in RAM, so UI needs no module round trip per station.
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef DABStations_h
+#define DABStations_h
+
+#include "DABDUINO.h"
+
+#ifndef DAB_MAX_STATIONS
+#define DAB_MAX_STATIONS 32
+#endif
+#define DAB_STATION_NAME_LENGTH 16
+#define DAB_STATIONS_BATCH 8 // commands per pipelined batch
+#define DAB_PREFETCH_RANGE 3 // stations prefetched on both sides of cursor
+#define DAB_PREFETCH_IDLE 20 // serial line idle time before prefetch (ms)
+#ifndef DAB_STATION_KEYS
+#define DAB_STATION_KEYS 64 // slots of station key table, power of 2 > DAB_MAX_STATIONS
+#endif
+#if DAB_STATION_KEYS <= DAB_MAX_STATIONS || DAB_STATION_KEYS > 256 || (DAB_STATION_KEYS & (DAB_STATION_KEYS - 1))
+#error "DAB_STATION_KEYS must be power of 2 greater than DAB_MAX_STATIONS, at most 256"
+#endif
+
+// station fields
+#define DAB_STATION_NAME 0x01
+#define DAB_STATION_INFO 0x02 // serviceId, ensembleId
+#define DAB_STATION_FREQUENCY 0x04
+#define DAB_STATION_TYPE 0x08
+#define DAB_STATION_ON_AIR 0x10 // not in DAB_STATION_ALL, costs one more command per station
+#define DAB_STATION_ALL 0x0F
+#define DAB_STATION_FIELDS 0x1F // every field
+#define DAB_STATION_VOLATILE (DAB_STATION_NAME | DAB_STATION_ON_AIR) // may change for same service (see update)
+
+// station changes (see update)
+#define DAB_STATION_ADDED 1
+#define DAB_STATION_REMOVED 2
+#define DAB_STATION_MOVED 3
+#define DAB_STATION_UPDATED 4 // last call of update, programIndex = number of stations
+
+struct DABStation
+{
+  uint32_t serviceId;
+  uint16_t ensembleId;
+  uint8_t frequencyIndex; // see getFrequency
+  uint8_t serviceType; // see getServCompType
+  uint8_t onAir; // see isProgramOnAir
+  uint8_t valid; // loaded fields
+  char name[DAB_STATION_NAME_LENGTH + 1]; // service long name
+};
+
+/*
+ * Stable station key, program index changes with program sorter (event 4)
+ * and reconfiguration (event 3), key does not
+ */
+struct DABStationKey
+{
+  uint32_t serviceId;
+  uint16_t ensembleId;
+};
+
+struct DABUpdateStats
+{
+  uint16_t added;
+  uint16_t removed;
+  uint16_t moved; // same service at other program index
+  uint32_t commands; // sent by update
+  uint32_t fullCommands; // full reload of same fields would send
+};
+
+/*
+ * Receiver of station changes found by update
+ * programIndex = new index (DAB_STATION_ADDED, DAB_STATION_MOVED), old index (DAB_STATION_REMOVED)
+ * oldIndex = old index (DAB_STATION_MOVED)
+ * station = NULL for DAB_STATION_UPDATED
+ */
+typedef void (*DABStationsHandler)(void *context, uint8_t change, uint16_t programIndex, uint16_t oldIndex, const DABStation *station);
+
+class DABStations
+{
+public:
+
+  DABStations(DABDUINO& dab);
+
+  int8_t load(uint8_t fields);
+  int8_t loadStation(uint32_t programIndex, uint8_t fields);
+  int8_t update(uint8_t fields, DABStationsHandler handler, void *context);
+  const DABUpdateStats *getUpdateStats();
+  void clear();
+
+  uint16_t getCount();
+  DABStation *getStation(uint32_t programIndex);
+  int16_t findService(uint32_t serviceId, uint16_t ensembleId);
+  int8_t getKey(uint32_t programIndex, DABStationKey *key);
+  int16_t findKey(const DABStationKey *key);
+
+  void setCursor(uint32_t programIndex);
+  int8_t prefetch(uint8_t fields);
+
+private:
+  uint8_t fetch(uint16_t firstProgram, uint16_t lastProgram, uint8_t fields, const uint8_t programFields[] = NULL);
+  void store(uint16_t program, uint8_t field, byte dabData[], uint32_t dabDataSize);
+  static void buildCommand(byte dabCommand[], uint16_t program, uint8_t field);
+  static void response(void *context, uint8_t index, int8_t status, byte dabData[], uint32_t dabDataSize);
+  static void prefetchResponse(void *context, uint8_t index, int8_t status, byte dabData[], uint32_t dabDataSize);
+  static void infoResponse(void *context, uint8_t index, int8_t status, byte dabData[], uint32_t dabDataSize);
+  void move(uint8_t target[], uint16_t oldCount);
+  static uint8_t keyHash(uint32_t serviceId, uint16_t ensembleId);
+  void keyInsert(uint16_t program);
+  void keyRemove(uint16_t program);
+
+  DABDUINO *dab;
+  DABStation stations[DAB_MAX_STATIONS];
+  uint16_t count;
+  uint8_t keys[DAB_STATION_KEYS]; // program index + 1 by key hash, 0=free
+
+  // prefetch
+  uint32_t cursor;
+  boolean prefetchPending;
+  uint16_t prefetchProgram;
+  uint8_t prefetchField;
+
+  // pipelined batch
+  uint16_t batchProgram[DAB_STATIONS_BATCH];
+  uint8_t batchField[DAB_STATIONS_BATCH];
+
+  // update
+  DABUpdateStats updateStats;
+  uint32_t *updateServiceIds; // module list while update runs
+  uint16_t *updateEnsembleIds;
+  uint8_t *updateFound;
+};
+
+#endif
@@ -0,0 +1,202 @@
+/*
+ * DABTextCache.cpp - DAB program text (DLS) cache for DABDUINO library.
+ * @license  BSD (see license.txt)
+ */
+
+#include "DABTextCache.h"
+
+DABTextCache::DABTextCache() {
+
+  clear();
+}
+
+/*
+ * Hash (FNV-1a) of raw text data from module
+ */
+uint32_t DABTextCache::hash(const byte data[], uint32_t dataSize) {
+
+  uint32_t h = 2166136261UL;
+  for (uint32_t i = 0; i < dataSize; i++) {
+    h = (h ^ data[i]) * 16777619UL;
+  }
+  return h ? h : 1; // 0 is reserved for "no text"
+}
+
+/*
+ * Parse artist and title from DAB text
+ * Module gives no DL Plus tags, so common "Artist - Title", "Title by Artist"
+ * and "Artist / Title" texts (optionally with "Now playing:" prefix) are recognized.
+ * return: 1=artist and title found, 0=text is not song
+ */
+int8_t DABTextCache::parseTags(const char text[], char artist[], char title[]) {
+
+  static const char *prefixes[] = { "now playing", "now on air", "on air", "playing", "np" };
+  static const char *separators[] = { " - ", " by ", " / " };
+
+  // skip prefix
+  const char *start = text;
+  while (*start == ' ') start++;
+  for (uint8_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); i++) {
+    size_t length = strlen(prefixes[i]);
+    if (strncasecmp(start, prefixes[i], length) == 0 && (start[length] == ':' || start[length] == ' ')) {
+      start += length;
+      while (*start == ':' || *start == ' ') start++;
+      break;
+    }
+  }
+
+  for (uint8_t i = 0; i < sizeof(separators) / sizeof(separators[0]); i++) {
+    const char *separator = strstr(start, separators[i]);
+    if (!separator || separator == start) continue;
+    const char *first = start;
+    const char *second = separator + strlen(separators[i]);
+    size_t firstLength = separator - first;
+    size_t secondLength = strlen(second);
+    while (secondLength && second[secondLength - 1] == ' ') secondLength--;
+    while (firstLength && first[firstLength - 1] == ' ') firstLength--;
+    if (!firstLength || !secondLength) continue;
+    if (firstLength >= DAB_MAX_TAG_LENGTH) firstLength = DAB_MAX_TAG_LENGTH - 1;
+    if (secondLength >= DAB_MAX_TAG_LENGTH) secondLength = DAB_MAX_TAG_LENGTH - 1;
+    // "Title by Artist"
+    char *firstTag = (i == 1) ? title : artist;
+    char *secondTag = (i == 1) ? artist : title;
+    memcpy(firstTag, first, firstLength);
+    firstTag[firstLength] = 0x00;
+    memcpy(secondTag, second, secondLength);
+    secondTag[secondLength] = 0x00;
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * Clear all cached texts
+ */
+void DABTextCache::clear() {
+
+  programsCount = 0;
+}
+
+/*
+ * Store new text of program
+ * Same text received again is moved to the newest position with new time.
+ * Least recently used program is replaced when cache is full.
+ */
+int8_t DABTextCache::store(uint32_t programKey, uint32_t hash, const char text[]) {
+
+  DABTextProgram *program = findOrAdd(programKey);
+  uint8_t i = 0;
+  while (i < program->count && program->history[i].hash != hash) {
+    i++;
+  }
+  if (i == DAB_TEXT_CACHE_HISTORY) {
+    i--; // drop oldest
+  } else if (i == program->count) {
+    program->count++;
+  }
+  for (; i > 0; i--) {
+    program->history[i] = program->history[i - 1];
+  }
+  program->history[0].hash = hash;
+  program->history[0].time = millis();
+  strncpy(program->history[0].text, text, DAB_MAX_TEXT_LENGTH - 1);
+  program->history[0].text[DAB_MAX_TEXT_LENGTH - 1] = 0x00;
+
+  // tags are kept until next song text (station jingles, phone numbers etc.)
+  char artist[DAB_MAX_TAG_LENGTH];
+  char title[DAB_MAX_TAG_LENGTH];
+  if (parseTags(program->history[0].text, artist, title)) {
+    if (strcmp(artist, program->artist) || strcmp(title, program->title)) {
+      strcpy(program->artist, artist);
+      strcpy(program->title, title);
+      program->tagsTime = program->history[0].time;
+    }
+  }
+  return 1;
+}
+
+/*
+ * Get number of cached texts of program
+ */
+uint8_t DABTextCache::getCount(uint32_t programKey) {
+
+  DABTextProgram *program = find(programKey);
+  return program ? program->count : 0;
+}
+
+/*
+ * Get cached text of program
+ * age = 0=newest text, 1=previous text,...
+ * time = millis() of receive
+ * return: 1=text found, 0=no text
+ */
+int8_t DABTextCache::getText(uint32_t programKey, uint8_t age, char text[], unsigned long *time) {
+
+  DABTextProgram *program = find(programKey);
+  if (program && age < program->count) {
+    strcpy(text, program->history[age].text);
+    *time = program->history[age].time;
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * Get tag of last song of program
+ * contentType = DAB_DLPLUS_ITEM_TITLE, DAB_DLPLUS_ITEM_ARTIST
+ * time = millis() of tag change
+ * return: 1=tag found, 0=no tag
+ */
+int8_t DABTextCache::getTag(uint32_t programKey, uint8_t contentType, char tag[], unsigned long *time) {
+
+  DABTextProgram *program = find(programKey);
+  if (!program || !program->tagsTime) {
+    return 0;
+  }
+  switch (contentType) {
+  case DAB_DLPLUS_ITEM_TITLE:
+    strcpy(tag, program->title);
+    break;
+  case DAB_DLPLUS_ITEM_ARTIST:
+    strcpy(tag, program->artist);
+    break;
+  default:
+    return 0;
+  }
+  *time = program->tagsTime;
+  return 1;
+}
+
+DABTextProgram *DABTextCache::find(uint32_t programKey) {
+
+  for (uint8_t i = 0; i < programsCount; i++) {
+    if (programs[i].programKey == programKey) {
+      return &programs[i];
+    }
+  }
+  return NULL;
+}
+
+DABTextProgram *DABTextCache::findOrAdd(uint32_t programKey) {
+
+  DABTextProgram *program = find(programKey);
+  if (!program) {
+    if (programsCount < DAB_TEXT_CACHE_PROGRAMS) {
+      program = &programs[programsCount++];
+    } else {
+      program = &programs[0];
+      for (uint8_t i = 1; i < programsCount; i++) {
+        if (programs[i].lastUsed - program->lastUsed > 0x80000000UL) {
+          program = &programs[i]; // older
+        }
+      }
+    }
+    program->programKey = programKey;
+    program->count = 0;
+    program->tagsTime = 0;
+    program->artist[0] = 0x00;
+    program->title[0] = 0x00;
+  }
+  program->lastUsed = millis();
+  return program;
+}
@@ -0,0 +1,68 @@
+/*
+ * DABTextCache.h - DAB program text (DLS) cache for DABDUINO library.
+ * Keeps last distinct texts of every program with time of receive
+ * and artist/title (DL Plus item tags) of last song.
+ * @license  BSD (see license.txt)
+ */
+
+#ifndef DABTextCache_h
+#define DABTextCache_h
+
+#include "DABDUINO.h"
+
+#ifndef DAB_TEXT_CACHE_PROGRAMS
+#define DAB_TEXT_CACHE_PROGRAMS 4 // number of cached programs
+#endif
+#ifndef DAB_TEXT_CACHE_HISTORY
+#define DAB_TEXT_CACHE_HISTORY 4 // number of distinct texts per program
+#endif
+#define DAB_MAX_TAG_LENGTH 48
+// program key of FM station is frequency | DAB_TEXT_KEY_FM, DAB program key is program index
+#define DAB_TEXT_KEY_FM 0x80000000UL
+
+// DL Plus content types
+#define DAB_DLPLUS_ITEM_TITLE 1
+#define DAB_DLPLUS_ITEM_ARTIST 4
+
+struct DABTextEntry
+{
+  uint32_t hash;
+  unsigned long time; // millis() of receive
+  char text[DAB_MAX_TEXT_LENGTH];
+};
+
+struct DABTextProgram
+{
+  uint32_t programKey;
+  unsigned long lastUsed;
+  uint8_t count;
+  unsigned long tagsTime; // millis() of last artist/title change, 0=no tags
+  char artist[DAB_MAX_TAG_LENGTH];
+  char title[DAB_MAX_TAG_LENGTH];
+  DABTextEntry history[DAB_TEXT_CACHE_HISTORY]; // 0=newest
+};
+
+class DABTextCache
+{
+public:
+
+  DABTextCache();
+
+  static uint32_t hash(const byte data[], uint32_t dataSize);
+  static int8_t parseTags(const char text[], char artist[], char title[]);
+
+  void clear();
+  int8_t store(uint32_t programKey, uint32_t hash, const char text[]);
+  uint8_t getCount(uint32_t programKey);
+  int8_t getText(uint32_t programKey, uint8_t age, char text[], unsigned long *time);
+  int8_t getTag(uint32_t programKey, uint8_t contentType, char tag[], unsigned long *time);
+
+private:
+  DABTextProgram *find(uint32_t programKey);
+  DABTextProgram *findOrAdd(uint32_t programKey);
+
+  DABTextProgram programs[DAB_TEXT_CACHE_PROGRAMS];
+  uint8_t programsCount;
+};
+
+#endif